@@ -0,0 +1,161 @@
+#include "device_identity.h"
+
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+#include "hardware/flash.h"
+#include "hardware/watchdog.h"
+#include "pico/rand.h"
+#include "flash_layout.h"
+#include "flash_ops.h"
+#include "switch_pro_descriptors.h"
+
+#ifdef SWITCH_PICO_LOG
+#define LOG_PRINTF(...) printf(__VA_ARGS__)
+#else
+#define LOG_PRINTF(...) ((void)0)
+#endif
+
+#define IDENTITY_MAGIC 0x44495053u  // "SPID"
+#define IDENTITY_VERSION 1
+#define IDENTITY_COMMIT_DELAY_US 5000  // lets the reply frame leave UART1 first
+
+// Layout of the identity sector's first flash page.
+typedef struct __attribute__((packed)) {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t length;  // sizeof(DeviceIdentity), so later versions can append fields
+    DeviceIdentity identity;
+    uint8_t reserved;
+    uint32_t checksum;  // FNV-1a over everything above
+} StoredIdentity;
+
+static_assert(sizeof(StoredIdentity) <= FLASH_PAGE_SIZE, "identity record must fit one flash page");
+
+static bool g_storage_available = false;
+static DeviceIdentity g_active{};
+static DeviceIdentity g_staged{};
+static bool g_staged_valid = false;
+static absolute_time_t g_commit_time;
+
+static uint32_t record_checksum(const StoredIdentity& record) {
+    const uint8_t* bytes = reinterpret_cast<const uint8_t*>(&record);
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < offsetof(StoredIdentity, checksum); ++i) {
+        hash = (hash ^ bytes[i]) * 16777619u;
+    }
+    return hash;
+}
+
+static bool identity_valid(const DeviceIdentity& identity) {
+    static const uint8_t zero_mac[6] = {};
+    static const uint8_t erased_mac[6] = {0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF};
+    if (memcmp(identity.mac, zero_mac, 6) == 0 || memcmp(identity.mac, erased_mac, 6) == 0) {
+        return false;
+    }
+    if (identity.mac[0] & 0x01) {
+        return false;  // multicast addresses are not valid device addresses
+    }
+    switch (identity.controller_type) {
+        case SWITCH_TYPE_LEFT_JOYCON:
+        case SWITCH_TYPE_RIGHT_JOYCON:
+        case SWITCH_TYPE_PRO_CONTROLLER:
+        case SWITCH_TYPE_FAMICOM_LEFT_JOYCON:
+        case SWITCH_TYPE_FAMICOM_RIGHT_JOYCON:
+        case SWITCH_TYPE_NES_LEFT_JOYCON:
+        case SWITCH_TYPE_NES_RIGHT_JOYCON:
+        case SWITCH_TYPE_SNES:
+        case SWITCH_TYPE_N64:
+            return true;
+        default:
+            return false;
+    }
+}
+
+static bool read_record(DeviceIdentity* out) {
+    StoredIdentity record;
+    memcpy(&record, flash_ops_xip(IDENTITY_FLASH_OFFSET), sizeof(record));
+    if (record.magic != IDENTITY_MAGIC || record.version != IDENTITY_VERSION ||
+        record.length != sizeof(DeviceIdentity) || record.checksum != record_checksum(record) ||
+        !identity_valid(record.identity)) {
+        return false;
+    }
+    *out = record.identity;
+    return true;
+}
+
+// Erases the identity sector: only done at boot or right before a reboot.
+static bool write_record(const DeviceIdentity& identity) {
+    uint8_t page[FLASH_PAGE_SIZE];
+    memset(page, 0xFF, sizeof(page));
+    StoredIdentity record{};
+    record.magic = IDENTITY_MAGIC;
+    record.version = IDENTITY_VERSION;
+    record.length = sizeof(DeviceIdentity);
+    record.identity = identity;
+    record.reserved = 0xFF;
+    record.checksum = record_checksum(record);
+    memcpy(page, &record, sizeof(record));
+    return flash_ops_erase_sector(IDENTITY_FLASH_OFFSET) &&
+           flash_ops_program(IDENTITY_FLASH_OFFSET, page, sizeof(page));
+}
+
+void device_identity_load(const DeviceIdentity& defaults, DeviceIdentity* out) {
+    g_storage_available = flash_ops_persistent_area_free();
+    if (g_storage_available && read_record(&g_active)) {
+        *out = g_active;
+        return;
+    }
+
+    // First boot (or a corrupt record): keep the default OUI, randomise the rest once.
+    g_active = defaults;
+    uint32_t random = get_rand_32();
+    g_active.mac[3] = static_cast<uint8_t>(random);
+    g_active.mac[4] = static_cast<uint8_t>(random >> 8);
+    g_active.mac[5] = static_cast<uint8_t>(random >> 16);
+    if (!g_storage_available) {
+        LOG_PRINTF("[ID] program image overlaps identity storage; MAC changes every boot\n");
+    } else if (!write_record(g_active)) {
+        LOG_PRINTF("[ID] failed to store generated identity\n");
+    } else {
+        LOG_PRINTF("[ID] generated MAC %02x:%02x:%02x:%02x:%02x:%02x\n", g_active.mac[0], g_active.mac[1],
+                   g_active.mac[2], g_active.mac[3], g_active.mac[4], g_active.mac[5]);
+    }
+    *out = g_active;
+}
+
+DeviceIdentityStatus device_identity_stage(const DeviceIdentity& identity) {
+    if (!g_storage_available || !identity_valid(identity)) {
+        return DEVICE_IDENTITY_REJECTED;
+    }
+    g_staged = identity;
+    g_staged_valid = true;
+    g_commit_time = make_timeout_time_us(IDENTITY_COMMIT_DELAY_US);
+    return DEVICE_IDENTITY_PENDING;
+}
+
+DeviceIdentityStatus device_identity_current(DeviceIdentity* out) {
+    *out = g_staged_valid ? g_staged : g_active;
+    return g_staged_valid ? DEVICE_IDENTITY_PENDING : DEVICE_IDENTITY_ACTIVE;
+}
+
+absolute_time_t device_identity_next_task_time() {
+    return g_staged_valid ? g_commit_time : at_the_end_of_time;
+}
+
+// Erasing stalls USB for tens of milliseconds, which is harmless here because
+// the Pico re-enumerates straight afterwards anyway.
+void device_identity_task() {
+    if (!g_staged_valid || absolute_time_diff_us(get_absolute_time(), g_commit_time) > 0) {
+        return;
+    }
+    g_staged_valid = false;
+    if (!write_record(g_staged)) {
+        LOG_PRINTF("[ID] failed to store new identity\n");
+        return;
+    }
+    // The MAC and colours are read by the console during the handshake, so a
+    // clean re-enumeration is the simplest way to present the new identity.
+    LOG_PRINTF("[ID] identity stored; rebooting\n");
+    watchdog_reboot(0, 0, 10);
+}
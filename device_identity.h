@@ -0,0 +1,49 @@
+/*
+ * Per-unit controller identity: Bluetooth MAC, serial number, colours and
+ * controller type. Kept in its own flash sector so a unit keeps the same MAC
+ * across power cycles (the console recognises it instead of re-registering)
+ * and can be re-provisioned over UART without rebuilding the firmware.
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "pico/time.h"
+
+// Wire and flash layout; also the payload of UART_FRAME_IDENTITY_SET.
+typedef struct __attribute__((packed)) {
+    uint8_t mac[6];             // most significant byte first, as shown by the console
+    uint8_t controller_type;    // SwitchControllerType
+    uint8_t serial[16];         // 0xFF = no serial
+    uint8_t body_color[3];      // RGB
+    uint8_t button_color[3];
+    uint8_t left_grip_color[3];
+    uint8_t right_grip_color[3];
+} DeviceIdentity;
+
+static_assert(sizeof(DeviceIdentity) == 35, "DeviceIdentity must match the UART payload");
+
+typedef enum {
+    DEVICE_IDENTITY_ACTIVE = 0,   // record in use since boot
+    DEVICE_IDENTITY_PENDING = 1,  // staged; stored and applied by a reboot moments later
+    DEVICE_IDENTITY_REJECTED = 2, // invalid record or identity storage unavailable
+} DeviceIdentityStatus;
+
+// Load the stored identity into *out. On first boot the defaults are used with
+// a freshly randomised MAC, and the result is written so it survives reboots.
+// Call on core 0 before core 1 is launched.
+void device_identity_load(const DeviceIdentity& defaults, DeviceIdentity* out);
+
+// Queue a new identity. device_identity_task() writes it shortly afterwards
+// (leaving time for the UART reply to go out) and reboots to apply it.
+DeviceIdentityStatus device_identity_stage(const DeviceIdentity& identity);
+
+// The identity the next boot will use (staged if any, else the active one).
+DeviceIdentityStatus device_identity_current(DeviceIdentity* out);
+
+// Write a staged identity and reboot once its commit time has come.
+void device_identity_task();
+
+// When device_identity_task() next has work (at_the_end_of_time if none).
+absolute_time_t device_identity_next_task_time();
@@ -0,0 +1,24 @@
+# example_device_macro.py
+# Run a button sequence on the Pico itself, so its timing follows the
+# controller's report clock instead of host scheduling.
+from switch_pico_bridge import MacroBuilder, SwitchButton, SwitchDpad, SwitchUARTClient, first_serial_port
+
+PORT = first_serial_port(include_descriptions=["USB to UART"]) or "COM5"
+
+
+def main() -> None:
+    macro = MacroBuilder()
+    with macro.loop(5):
+        macro.press(SwitchButton.A).wait_reports(2).release(SwitchButton.A)
+        macro.wait_ms(200)
+    macro.hat(SwitchDpad.RIGHT).wait_ms(500).hat(SwitchDpad.CENTER)
+    macro.left_stick(0.0, -1.0).wait_ms(300).neutral()
+
+    # auto_send=False: the macro is overlaid on host input, so neutral frames are fine but unnecessary.
+    with SwitchUARTClient(PORT, auto_send=False) as client:
+        print("start:", client.run_macro(macro.build()))
+        print("status:", client.macro_status())
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,27 @@
+/*
+ * Layout of the firmware's persistent data in the Pico's own flash. Data is
+ * carved from the top of flash downwards; the program image grows up from
+ * the bottom and must end below the lowest offset here.
+ */
+
+#pragma once
+
+#include "hardware/flash.h"
+
+// Log-structured store behind the emulated SPI_WRITE / SPI_ERASE commands.
+// The log rotates through these sectors to spread erase wear.
+#define SPI_STORE_SECTOR_COUNT 4
+#define SPI_STORE_FLASH_OFFSET (PICO_FLASH_SIZE_BYTES - SPI_STORE_SECTOR_COUNT * FLASH_SECTOR_SIZE)
+
+// Provisioned controller identity (MAC, serial, colours), one record per sector.
+#define IDENTITY_FLASH_OFFSET (SPI_STORE_FLASH_OFFSET - FLASH_SECTOR_SIZE)
+
+// Saved macros, one sector each. The spare sectors are kept erased, so a save
+// writes into one of them without erasing while the console is connected.
+#define MACRO_LIBRARY_SLOTS 8
+#define MACRO_LIBRARY_SPARE_SECTORS 4
+#define MACRO_LIBRARY_SECTORS (MACRO_LIBRARY_SLOTS + MACRO_LIBRARY_SPARE_SECTORS)
+#define MACRO_LIBRARY_FLASH_OFFSET (IDENTITY_FLASH_OFFSET - MACRO_LIBRARY_SECTORS * FLASH_SECTOR_SIZE)
+
+// Lowest flash offset used for persistent data.
+#define PERSISTENT_FLASH_OFFSET MACRO_LIBRARY_FLASH_OFFSET
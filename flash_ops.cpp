@@ -0,0 +1,56 @@
+#include "flash_ops.h"
+
+#include "hardware/flash.h"
+#include "hardware/sync.h"
+#include "pico/flash.h"
+#include "pico/multicore.h"
+#include "flash_layout.h"
+
+#define FLASH_OPS_LOCKOUT_TIMEOUT_MS 10
+
+typedef struct {
+    uint32_t offset;
+    const uint8_t* data;
+    uint32_t size;
+} FlashOp;
+
+static void program_op(void* param) {
+    const FlashOp* op = static_cast<const FlashOp*>(param);
+    flash_range_program(op->offset, op->data, op->size);
+}
+
+static void erase_op(void* param) {
+    const FlashOp* op = static_cast<const FlashOp*>(param);
+    flash_range_erase(op->offset, op->size);
+}
+
+// At boot core 1 is not running yet, so masking interrupts is enough; later
+// flash_safe_execute() also parks core 1 while XIP is unavailable.
+static bool run_flash_op(void (*fn)(void*), FlashOp* op) {
+    if (!multicore_lockout_victim_is_initialized(1)) {
+        uint32_t irq = save_and_disable_interrupts();
+        fn(op);
+        restore_interrupts(irq);
+        return true;
+    }
+    return flash_safe_execute(fn, op, FLASH_OPS_LOCKOUT_TIMEOUT_MS) == PICO_OK;
+}
+
+bool flash_ops_erase_sector(uint32_t offset) {
+    FlashOp op{offset, nullptr, FLASH_SECTOR_SIZE};
+    return run_flash_op(erase_op, &op);
+}
+
+bool flash_ops_program(uint32_t offset, const uint8_t* data, uint32_t size) {
+    FlashOp op{offset, data, size};
+    return run_flash_op(program_op, &op);
+}
+
+const uint8_t* flash_ops_xip(uint32_t offset) {
+    return reinterpret_cast<const uint8_t*>(XIP_BASE + offset);
+}
+
+bool flash_ops_persistent_area_free() {
+    extern char __flash_binary_end;
+    return reinterpret_cast<uintptr_t>(&__flash_binary_end) - XIP_BASE <= PERSISTENT_FLASH_OFFSET;
+}
@@ -0,0 +1,22 @@
+/*
+ * Erase/program helpers for the firmware's persistent flash areas. Safe to
+ * call on core 0 both before core 1 is launched (interrupts are masked) and
+ * afterwards (core 1 is parked via flash_safe_execute()).
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// offset is from the start of flash and must be sector aligned.
+bool flash_ops_erase_sector(uint32_t offset);
+
+// offset must be page aligned and size a multiple of FLASH_PAGE_SIZE; data must be in RAM.
+bool flash_ops_program(uint32_t offset, const uint8_t* data, uint32_t size);
+
+// Start of a flash offset in the XIP address space.
+const uint8_t* flash_ops_xip(uint32_t offset);
+
+// False if the program image reaches into the persistent area of flash_layout.h.
+bool flash_ops_persistent_area_free();
@@ -0,0 +1,107 @@
+#include "gpio_buttons.h"
+
+#include "hardware/gpio.h"
+#include "pico/platform.h"
+#include "pico/time.h"
+
+#define GPIO_BUTTONS_SAMPLE_INTERVAL_US 1000
+
+typedef struct {
+    uint8_t pin;
+    uint32_t button;  // SWITCH_PRO_MASK_* or GPIO_BUTTON_DPAD_*
+} GpioButtonPin;
+
+// Default wiring, each button between its pin and ground. It avoids UART0
+// (debug log, GPIO 0/1), UART1 (GPIO 4/5) and the PIO link's default pins
+// (GPIO 6/7); edit it to match your build.
+static const GpioButtonPin kButtonPins[] = {
+    {2, GPIO_BUTTON_DPAD_UP},
+    {3, GPIO_BUTTON_DPAD_DOWN},
+    {8, GPIO_BUTTON_DPAD_LEFT},
+    {9, GPIO_BUTTON_DPAD_RIGHT},
+    {10, SWITCH_PRO_MASK_B},
+    {11, SWITCH_PRO_MASK_A},
+    {12, SWITCH_PRO_MASK_Y},
+    {13, SWITCH_PRO_MASK_X},
+    {14, SWITCH_PRO_MASK_L},
+    {15, SWITCH_PRO_MASK_R},
+    {16, SWITCH_PRO_MASK_ZL},
+    {17, SWITCH_PRO_MASK_ZR},
+    {18, SWITCH_PRO_MASK_MINUS},
+    {19, SWITCH_PRO_MASK_PLUS},
+    {20, SWITCH_PRO_MASK_HOME},
+    {21, SWITCH_PRO_MASK_CAPTURE},
+    {22, SWITCH_PRO_MASK_L3},
+    {26, SWITCH_PRO_MASK_R3},
+};
+
+#define GPIO_BUTTON_PIN_COUNT (sizeof(kButtonPins) / sizeof(kButtonPins[0]))
+
+static_assert(GPIO_BUTTONS_DEBOUNCE_MS >= 1 && GPIO_BUTTONS_DEBOUNCE_MS < 256, "integrators are 8-bit");
+
+static repeating_timer_t g_sample_timer;
+static uint8_t g_integrators[GPIO_BUTTON_PIN_COUNT];  // timer IRQ only
+static volatile uint32_t g_debounced = 0;              // written by the timer IRQ only
+static uint32_t g_polled = 0;
+static bool g_polled_once = false;
+
+// Each integrator counts towards GPIO_BUTTONS_DEBOUNCE_MS while its pin reads
+// pressed and towards 0 while released; the output only flips at either end,
+// so a bounce has to outlast the whole window to register.
+static bool __not_in_flash_func(sample_buttons)(repeating_timer_t* timer) {
+    (void)timer;
+    uint32_t levels = gpio_get_all();
+    uint32_t debounced = g_debounced;
+    for (uint8_t i = 0; i < GPIO_BUTTON_PIN_COUNT; ++i) {
+        const GpioButtonPin& pin = kButtonPins[i];
+        bool pressed = !(levels & (1u << pin.pin));  // active low
+        uint8_t& integrator = g_integrators[i];
+        if (pressed) {
+            if (integrator < GPIO_BUTTONS_DEBOUNCE_MS && ++integrator == GPIO_BUTTONS_DEBOUNCE_MS) {
+                debounced |= pin.button;
+            }
+        } else if (integrator > 0 && --integrator == 0) {
+            debounced &= ~pin.button;
+        }
+    }
+    g_debounced = debounced;
+    return true;  // keep repeating
+}
+
+void gpio_buttons_init() {
+    uint32_t pin_mask = 0;
+    for (const GpioButtonPin& pin : kButtonPins) {
+        pin_mask |= 1u << pin.pin;
+    }
+    gpio_init_mask(pin_mask);  // inputs
+    for (const GpioButtonPin& pin : kButtonPins) {
+        gpio_pull_up(pin.pin);
+    }
+    // Negative interval: measured start to start, so sampling does not drift.
+    add_repeating_timer_us(-GPIO_BUTTONS_SAMPLE_INTERVAL_US, sample_buttons, nullptr, &g_sample_timer);
+}
+
+uint32_t gpio_buttons_mask() {
+    return g_debounced;
+}
+
+bool gpio_buttons_poll(SwitchInputState* state) {
+    uint32_t buttons = g_debounced;
+    if (g_polled_once && buttons == g_polled) {
+        return false;
+    }
+    g_polled = buttons;
+    g_polled_once = true;
+
+    *state = SwitchInputState{};
+    switch_input_set_buttons(state, static_cast<uint16_t>(buttons & 0xFFFF));
+    state->dpad_up = buttons & GPIO_BUTTON_DPAD_UP;
+    state->dpad_down = buttons & GPIO_BUTTON_DPAD_DOWN;
+    state->dpad_left = buttons & GPIO_BUTTON_DPAD_LEFT;
+    state->dpad_right = buttons & GPIO_BUTTON_DPAD_RIGHT;
+    state->lx = SWITCH_PRO_JOYSTICK_MID;
+    state->ly = SWITCH_PRO_JOYSTICK_MID;
+    state->rx = SWITCH_PRO_JOYSTICK_MID;
+    state->ry = SWITCH_PRO_JOYSTICK_MID;
+    return true;
+}
@@ -0,0 +1,38 @@
+/*
+ * Optional input source for buttons wired straight to the Pico's GPIOs
+ * (SWITCH_PICO_GPIO_BUTTONS), e.g. an arcade stick's microswitches between a
+ * pin and ground. A 1 kHz repeating timer samples every pin in one read and
+ * debounces each with an integrator, so a press costs at most
+ * GPIO_BUTTONS_DEBOUNCE_MS plus one sample. The result feeds INPUT_SLOT_GPIO
+ * of the input merge, alongside whatever sticks and IMU the UART host sends.
+ *
+ * The pin map is in gpio_buttons.cpp.
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "switch_pro_driver.h"
+
+#ifndef GPIO_BUTTONS_DEBOUNCE_MS
+#define GPIO_BUTTONS_DEBOUNCE_MS 3  // consecutive agreeing samples before a pin changes state
+#endif
+
+// Dpad bits alongside the SWITCH_PRO_MASK_* buttons in a debounced mask.
+#define GPIO_BUTTON_DPAD_UP (1u << 16)
+#define GPIO_BUTTON_DPAD_DOWN (1u << 17)
+#define GPIO_BUTTON_DPAD_LEFT (1u << 18)
+#define GPIO_BUTTON_DPAD_RIGHT (1u << 19)
+
+// Configure the pins (inputs with pull-ups) and start sampling. The timer
+// interrupt runs on the calling core.
+void gpio_buttons_init();
+
+// Debounced buttons, SWITCH_PRO_MASK_* | GPIO_BUTTON_DPAD_*. Safe from any context.
+uint32_t gpio_buttons_mask();
+
+// If the debounced buttons changed since the last call (or on the first
+// call), write them into *state with centred sticks and return true.
+// Call from a single context.
+bool gpio_buttons_poll(SwitchInputState* state);
@@ -0,0 +1,132 @@
+#include "input_merge.h"
+
+#include "pico/platform.h"
+
+// Per-axis distance from centre that still counts as a resting stick, so a
+// high-priority source's drift does not hide a stick another source moves.
+#define MERGE_STICK_REST_WINDOW 0x0C00
+
+static SwitchInputState g_slots[INPUT_MERGE_SLOTS];
+static uint8_t g_active = 0;
+static MergeStickPolicy g_policy = MERGE_STICKS_PRIORITY;
+static bool g_dirty = true;
+
+void input_merge_set(InputSlot slot, const SwitchInputState& state) {
+    g_slots[slot] = state;
+    g_active = static_cast<uint8_t>(g_active | (1u << slot));
+    g_dirty = true;
+}
+
+void input_merge_clear(InputSlot slot) {
+    g_active = static_cast<uint8_t>(g_active & ~(1u << slot));
+    g_dirty = true;
+}
+
+bool input_merge_set_policy(uint8_t policy) {
+    if (policy > MERGE_STICKS_MAX_MAGNITUDE) {
+        return false;
+    }
+    g_policy = static_cast<MergeStickPolicy>(policy);
+    g_dirty = true;
+    return true;
+}
+
+MergeStickPolicy input_merge_policy() {
+    return g_policy;
+}
+
+uint8_t input_merge_active_mask() {
+    return g_active;
+}
+
+typedef struct {
+    uint16_t x;
+    uint16_t y;
+} StickPosition;
+
+static StickPosition stick_of(const SwitchInputState& state, uint8_t stick) {
+    return stick == 0 ? StickPosition{state.lx, state.ly} : StickPosition{state.rx, state.ry};
+}
+
+// Squared distance from centre; at most 2 * 2^30, so it fits.
+static uint32_t stick_distance_sq(StickPosition position) {
+    int32_t dx = static_cast<int32_t>(position.x) - SWITCH_PRO_JOYSTICK_MID;
+    int32_t dy = static_cast<int32_t>(position.y) - SWITCH_PRO_JOYSTICK_MID;
+    return static_cast<uint32_t>(dx * dx) + static_cast<uint32_t>(dy * dy);
+}
+
+static bool stick_at_rest(StickPosition position) {
+    int32_t dx = static_cast<int32_t>(position.x) - SWITCH_PRO_JOYSTICK_MID;
+    int32_t dy = static_cast<int32_t>(position.y) - SWITCH_PRO_JOYSTICK_MID;
+    return dx > -MERGE_STICK_REST_WINDOW && dx < MERGE_STICK_REST_WINDOW && dy > -MERGE_STICK_REST_WINDOW &&
+           dy < MERGE_STICK_REST_WINDOW;
+}
+
+static StickPosition __not_in_flash_func(merge_stick)(uint8_t stick) {
+    StickPosition chosen = {SWITCH_PRO_JOYSTICK_MID, SWITCH_PRO_JOYSTICK_MID};
+    uint32_t chosen_distance = 0;
+    bool have_chosen = false;
+    for (uint8_t slot = 0; slot < INPUT_MERGE_SLOTS; ++slot) {
+        if (!(g_active & (1u << slot))) {
+            continue;
+        }
+        StickPosition position = stick_of(g_slots[slot], stick);
+        if (g_policy == MERGE_STICKS_PRIORITY) {
+            if (!stick_at_rest(position)) {
+                return position;
+            }
+            if (!have_chosen) {
+                chosen = position;  // every source resting: keep the top one's exact value
+                have_chosen = true;
+            }
+            continue;
+        }
+        uint32_t distance = stick_distance_sq(position);
+        if (!have_chosen || distance > chosen_distance) {  // ties go to the higher priority
+            chosen = position;
+            chosen_distance = distance;
+            have_chosen = true;
+        }
+    }
+    return chosen;
+}
+
+bool __not_in_flash_func(input_merge_update)(SwitchInputState* out) {
+    if (!g_dirty) {
+        return false;
+    }
+    g_dirty = false;
+
+    SwitchInputState merged{};
+    uint16_t buttons = 0;
+    bool have_imu = false;
+    for (uint8_t slot = 0; slot < INPUT_MERGE_SLOTS; ++slot) {
+        if (!(g_active & (1u << slot))) {
+            continue;
+        }
+        const SwitchInputState& source = g_slots[slot];
+        buttons |= switch_input_buttons(source);
+        merged.dpad_up |= source.dpad_up;
+        merged.dpad_down |= source.dpad_down;
+        merged.dpad_left |= source.dpad_left;
+        merged.dpad_right |= source.dpad_right;
+        if (!have_imu && source.imu_sample_count > 0) {
+            merged.imu_sample_count = source.imu_sample_count;
+            merged.imu_generation = source.imu_generation;
+            for (uint8_t i = 0; i < 3; ++i) {
+                merged.imu_samples[i] = source.imu_samples[i];
+            }
+            have_imu = true;
+        }
+    }
+    switch_input_set_buttons(&merged, buttons);
+
+    StickPosition left = merge_stick(0);
+    StickPosition right = merge_stick(1);
+    merged.lx = left.x;
+    merged.ly = left.y;
+    merged.rx = right.x;
+    merged.ry = right.y;
+    *out = merged;
+    return true;
+}
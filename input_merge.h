@@ -0,0 +1,45 @@
+/*
+ * Combines the controller state from several input sources into the one
+ * passed to switch_pro_set_input(). Buttons and dpad directions are ORed
+ * (opposing directions are left for the SOCD stage); each stick comes whole
+ * from one source, chosen by the stick policy. IMU samples come from the
+ * highest-priority source that sent any.
+ *
+ * A slot only takes part once its source has published a state, until it is
+ * cleared (switch-pico.cpp clears a serial link that goes silent). Lower slot
+ * numbers have higher priority. Core 0 only.
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "switch_pro_driver.h"
+
+typedef enum {
+    INPUT_SLOT_UART = 0,  // host bridge on UART1
+    INPUT_SLOT_PIO = 1,   // second serial link (SWITCH_PICO_PIO_RX)
+    INPUT_SLOT_GPIO = 2,  // buttons wired to the Pico
+    INPUT_MERGE_SLOTS
+} InputSlot;
+
+typedef enum {
+    MERGE_STICKS_PRIORITY = 0,       // highest-priority source whose stick is off centre
+    MERGE_STICKS_MAX_MAGNITUDE = 1,  // source pushing the stick furthest
+} MergeStickPolicy;
+
+void input_merge_set(InputSlot slot, const SwitchInputState& state);
+
+// Drop a source until it publishes again.
+void input_merge_clear(InputSlot slot);
+
+// Returns false for an unknown policy.
+bool input_merge_set_policy(uint8_t policy);
+MergeStickPolicy input_merge_policy();
+
+// Bit per slot taking part.
+uint8_t input_merge_active_mask();
+
+// Write the merged state if any slot or the policy changed since the last
+// call; returns whether it did.
+bool input_merge_update(SwitchInputState* out);
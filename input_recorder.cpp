@@ -0,0 +1,179 @@
+#include "input_recorder.h"
+
+#include <stdio.h>
+#include <string.h>
+#include "pico/platform.h"
+
+#ifdef SWITCH_PICO_LOG
+#define LOG_PRINTF(...) printf(__VA_ARGS__)
+#else
+#define LOG_PRINTF(...) ((void)0)
+#endif
+
+static RecordedRun g_runs[INPUT_RECORDER_RUNS];
+static uint16_t g_first = 0;  // ring index of the oldest run
+static uint16_t g_count = 0;
+
+static RecorderState g_state = RECORDER_IDLE;
+
+// Replay progress.
+static uint16_t g_position = 0;   // next run to load
+static uint16_t g_remaining = 0;  // reports left in the loaded run
+static bool g_replay_loaded = false;
+static RecordedRun g_replay_run;
+
+static RecordedRun& run_at(uint16_t index) {
+    return g_runs[(g_first + index) % INPUT_RECORDER_RUNS];
+}
+
+static void clear() {
+    g_first = 0;
+    g_count = 0;
+}
+
+void input_recorder_record() {
+    clear();
+    g_state = RECORDER_RECORDING;
+    LOG_PRINTF("[REC] recording from report %lu\n", (unsigned long)switch_pro_input_reports_sent());
+}
+
+RecorderResult input_recorder_replay() {
+    if (g_count == 0) {
+        return RECORDER_ERR_EMPTY;
+    }
+    g_position = 0;
+    g_remaining = 0;
+    g_replay_loaded = false;
+    g_state = RECORDER_REPLAYING;
+    LOG_PRINTF("[REC] replaying %u runs\n", g_count);
+    return RECORDER_OK;
+}
+
+void input_recorder_stop() {
+    g_state = RECORDER_IDLE;
+    g_replay_loaded = false;
+}
+
+RecorderState input_recorder_state() {
+    return g_state;
+}
+
+uint16_t input_recorder_count() {
+    return g_count;
+}
+
+uint16_t input_recorder_position() {
+    return g_position;
+}
+
+uint32_t input_recorder_report_count() {
+    return switch_pro_input_reports_sent();
+}
+
+uint8_t input_recorder_read(uint16_t index, RecordedRun* out, uint8_t max) {
+    uint8_t copied = 0;
+    while (copied < max && index + copied < g_count) {
+        out[copied] = run_at(static_cast<uint16_t>(index + copied));
+        copied++;
+    }
+    return copied;
+}
+
+RecorderResult input_recorder_write(uint16_t index, const RecordedRun* runs, uint8_t count) {
+    if (g_state != RECORDER_IDLE) {
+        return RECORDER_ERR_BUSY;
+    }
+    if (index == 0) {
+        clear();
+    }
+    if (index != g_count || g_count + count > INPUT_RECORDER_RUNS) {
+        return RECORDER_ERR_RANGE;
+    }
+    for (uint8_t i = 0; i < count; ++i) {
+        if (runs[i].repeat == 0) {
+            return RECORDER_ERR_INVALID;
+        }
+    }
+    for (uint8_t i = 0; i < count; ++i) {
+        run_at(g_count++) = runs[i];
+    }
+    return RECORDER_OK;
+}
+
+static void capture(const SwitchInputState& state, RecordedRun* run) {
+    uint16_t lx = state.lx >> 4, ly = state.ly >> 4;
+    uint16_t rx = state.rx >> 4, ry = state.ry >> 4;
+    run->report = switch_pro_input_reports_sent();  // this report goes out as the next one
+    run->repeat = 1;
+    run->buttons = switch_input_buttons(state);
+    run->hat = switch_input_raw_dpad(state);  // a hat would merge opposing directions
+    run->sticks[0] = static_cast<uint8_t>(lx);
+    run->sticks[1] = static_cast<uint8_t>((lx >> 8) | (ly << 4));
+    run->sticks[2] = static_cast<uint8_t>(ly >> 4);
+    run->sticks[3] = static_cast<uint8_t>(rx);
+    run->sticks[4] = static_cast<uint8_t>((rx >> 8) | (ry << 4));
+    run->sticks[5] = static_cast<uint8_t>(ry >> 4);
+    run->reserved = 0;
+}
+
+// Same output, ignoring where and how long the runs are.
+static bool same_input(const RecordedRun& a, const RecordedRun& b) {
+    return a.buttons == b.buttons && a.hat == b.hat && memcmp(a.sticks, b.sticks, sizeof(a.sticks)) == 0;
+}
+
+static void __not_in_flash_func(record)(const SwitchInputState& state) {
+    RecordedRun run;
+    capture(state, &run);
+    if (g_count > 0) {
+        RecordedRun& last = run_at(static_cast<uint16_t>(g_count - 1));
+        if (last.repeat < UINT16_MAX && same_input(last, run)) {
+            last.repeat++;
+            return;
+        }
+    }
+    if (g_count == INPUT_RECORDER_RUNS) {
+        g_first = static_cast<uint16_t>((g_first + 1) % INPUT_RECORDER_RUNS);  // drop the oldest
+        g_count--;
+    }
+    run_at(g_count++) = run;
+}
+
+static void __not_in_flash_func(advance_replay)() {
+    if (g_remaining == 0) {
+        if (g_position >= g_count) {
+            LOG_PRINTF("[REC] replay finished\n");
+            input_recorder_stop();
+            return;
+        }
+        g_replay_run = run_at(g_position++);
+        g_remaining = g_replay_run.repeat;
+        g_replay_loaded = true;
+    }
+    g_remaining--;
+}
+
+static void __not_in_flash_func(overlay)(const RecordedRun& run, SwitchInputState* state) {
+    // Widen the 12-bit values so the driver's >> 4 gives them back unchanged.
+    auto expand = [](uint16_t v) -> uint16_t {
+        return static_cast<uint16_t>(v << 4 | v >> 8);
+    };
+    switch_input_set_buttons(state, run.buttons);
+    switch_input_set_uart_hat(state, run.hat);
+    state->lx = expand(static_cast<uint16_t>(run.sticks[0] | (run.sticks[1] & 0x0F) << 8));
+    state->ly = expand(static_cast<uint16_t>(run.sticks[1] >> 4 | run.sticks[2] << 4));
+    state->rx = expand(static_cast<uint16_t>(run.sticks[3] | (run.sticks[4] & 0x0F) << 8));
+    state->ry = expand(static_cast<uint16_t>(run.sticks[4] >> 4 | run.sticks[5] << 4));
+}
+
+void __not_in_flash_func(input_recorder_apply)(SwitchInputState* state, bool new_report) {
+    if (new_report) {
+        if (g_state == RECORDER_RECORDING) {
+            record(*state);
+        } else if (g_state == RECORDER_REPLAYING) {
+            advance_replay();
+        }
+    }
+    if (g_state == RECORDER_REPLAYING && g_replay_loaded) {
+        overlay(g_replay_run, state);
+    }
+}
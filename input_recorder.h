@@ -0,0 +1,74 @@
+/*
+ * Records the input the driver actually reported to the Switch and replays
+ * it report for report. Consecutive identical reports are stored as one run,
+ * tagged with the number of the report that started it, in a RAM ring; once
+ * the ring is full the oldest runs are overwritten. The host can read the
+ * ring out over UART1 or load its own runs (a TAS input file) before a replay.
+ *
+ * Runs the last report filter stage: recording sees every other stage's
+ * output, and a replay overrides all of them. Replays begin on the next 0x30
+ * report and advance exactly one report at a time. IMU samples are not
+ * recorded.
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "switch_pro_driver.h"
+
+#ifndef INPUT_RECORDER_RUNS
+#define INPUT_RECORDER_RUNS 1024  // 16 bytes each
+#endif
+
+// One run of identical reports, as sent over UART (little endian).
+typedef struct __attribute__((packed)) {
+    uint32_t report;    // report counter value of the run's first report
+    uint16_t repeat;    // number of reports in the run, at least 1
+    uint16_t buttons;   // SWITCH_PRO_MASK_*
+    uint8_t hat;        // recorded as raw dpad bits (UART_HAT_RAW); a SWITCH_PRO_HAT_* value also replays
+    uint8_t sticks[6];  // lx, ly, rx, ry as 12-bit values, packed as in the input report
+    uint8_t reserved;
+} RecordedRun;
+
+static_assert(sizeof(RecordedRun) == 16, "recorded run layout is part of the UART protocol");
+
+typedef enum {
+    RECORDER_IDLE = 0,
+    RECORDER_RECORDING = 1,
+    RECORDER_REPLAYING = 2,
+} RecorderState;
+
+typedef enum {
+    RECORDER_OK = 0,
+    RECORDER_ERR_RANGE = 1,    // index outside the ring
+    RECORDER_ERR_INVALID = 2,  // malformed command or run
+    RECORDER_ERR_BUSY = 3,     // not allowed while recording or replaying
+    RECORDER_ERR_EMPTY = 4,    // nothing to replay
+} RecorderResult;
+
+// Clear the ring and record from the next report on.
+void input_recorder_record();
+
+// Replay the ring from its oldest run, starting on the next report.
+RecorderResult input_recorder_replay();
+
+void input_recorder_stop();
+
+RecorderState input_recorder_state();
+
+// Runs stored, and the run being replayed.
+uint16_t input_recorder_count();
+uint16_t input_recorder_position();
+
+// Reports sent since boot; the clock runs are tagged with.
+uint32_t input_recorder_report_count();
+
+// Copy up to max runs starting at index (0 = oldest). Returns the number copied.
+uint8_t input_recorder_read(uint16_t index, RecordedRun* out, uint8_t max);
+
+// Store runs at index; index 0 clears the ring first. Runs must be appended in order.
+RecorderResult input_recorder_write(uint16_t index, const RecordedRun* runs, uint8_t count);
+
+// Report filter stage; keep it last.
+void input_recorder_apply(SwitchInputState* state, bool new_report);
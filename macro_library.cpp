@@ -0,0 +1,421 @@
+#include "macro_library.h"
+
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+#include "hardware/flash.h"
+#include "pico/platform.h"
+#include "flash_layout.h"
+#include "flash_ops.h"
+
+#ifdef SWITCH_PICO_LOG
+#define LOG_PRINTF(...) printf(__VA_ARGS__)
+#else
+#define LOG_PRINTF(...) ((void)0)
+#endif
+
+#define MACRO_SLOT_MAGIC 0x434D5053u  // "SPMC"
+#define MACRO_FLASH_BUDGET_US 4000     // worst-case page program plus core 1 lockout
+#define MACRO_NO_SECTOR 0xFF
+
+/*
+ * A slot lives in whichever library sector holds a valid header naming it.
+ * A save programs a sector erased ahead of time, header page last, and then
+ * retires the slot's old sector by programming its magic to zero; if power
+ * is lost in between, the higher generation wins at boot. Sectors are only
+ * erased at boot or while USB is idle, so saving never holds back a report.
+ */
+typedef struct {
+    uint32_t magic;
+    uint16_t length;
+    uint16_t chord;
+    uint8_t slot;
+    uint8_t generation;  // bumped on every save of the slot
+    uint16_t reserved;
+    char name[MACRO_NAME_LENGTH];
+    uint32_t checksum;  // FNV-1a over everything from length to name, then the bytecode
+} MacroSlotHeader;
+
+static_assert(sizeof(MacroSlotHeader) == 32, "macro slot header size");
+static_assert(MACRO_SLOT_SIZE + sizeof(MacroSlotHeader) <= FLASH_SECTOR_SIZE, "a saved macro must fit one sector");
+static_assert(MACRO_LIBRARY_SECTORS <= 16, "erased sectors are tracked in a uint16_t");
+
+// Sector image of a pending save, so the RAM slot is free again at once.
+static uint8_t g_job_image[sizeof(MacroSlotHeader) + MACRO_SLOT_SIZE];
+
+static bool g_storage_available = false;
+static MacroSlotInfo g_slots[MACRO_LIBRARY_SLOTS];
+static uint8_t g_slot_sector[MACRO_LIBRARY_SLOTS];  // MACRO_NO_SECTOR when empty
+static uint8_t g_slot_generation[MACRO_LIBRARY_SLOTS];
+static uint16_t g_erased_sectors = 0;  // bit per sector known to be blank
+static bool g_usb_active = false;      // as last passed to macro_library_task()
+
+// Chord currently held down (hidden from the console until released).
+static uint16_t g_held_chord = 0;
+
+// A save or delete waiting to be written, one flash operation per task call.
+typedef enum {
+    MACRO_JOB_NONE,
+    MACRO_JOB_PROGRAM,  // program the page at g_job_page of g_job_sector, last page first
+    MACRO_JOB_RETIRE,   // zero the magic of the slot's old sector (all a delete needs)
+} MacroJobStep;
+
+static MacroJobStep g_job_step = MACRO_JOB_NONE;
+static uint8_t g_job_slot = 0;
+static uint8_t g_job_sector = 0;   // sector a save goes into
+static uint32_t g_job_length = 0;  // header + bytecode; 0 for a delete
+static uint32_t g_job_page = 0;
+static bool g_job_done = false;
+static MacroResult g_job_result = MACRO_OK;
+
+static uint32_t sector_flash_offset(uint8_t sector) {
+    return MACRO_LIBRARY_FLASH_OFFSET + sector * FLASH_SECTOR_SIZE;
+}
+
+static const uint8_t* sector_code(uint8_t sector) {
+    return flash_ops_xip(sector_flash_offset(sector)) + sizeof(MacroSlotHeader);
+}
+
+static const uint8_t* slot_code(uint8_t slot) {
+    return sector_code(g_slot_sector[slot]);
+}
+
+static uint32_t fnv1a(uint32_t hash, const void* data, uint32_t size) {
+    const uint8_t* bytes = static_cast<const uint8_t*>(data);
+    for (uint32_t i = 0; i < size; ++i) {
+        hash = (hash ^ bytes[i]) * 16777619u;
+    }
+    return hash;
+}
+
+static uint32_t slot_checksum(const MacroSlotHeader& header, const uint8_t* code) {
+    uint32_t hash = fnv1a(2166136261u, &header.length, offsetof(MacroSlotHeader, checksum) - offsetof(MacroSlotHeader, length));
+    return fnv1a(hash, code, header.length);
+}
+
+static bool read_sector_header(uint8_t sector, MacroSlotHeader* header) {
+    memcpy(header, flash_ops_xip(sector_flash_offset(sector)), sizeof(*header));
+    const uint8_t* code = sector_code(sector);
+    return header->magic == MACRO_SLOT_MAGIC && header->slot < MACRO_LIBRARY_SLOTS && header->length != 0 &&
+           header->length <= MACRO_SLOT_SIZE && header->checksum == slot_checksum(*header, code) &&
+           macro_validate(code, header->length);
+}
+
+static bool sector_blank(uint8_t sector) {
+    const uint32_t* words = reinterpret_cast<const uint32_t*>(flash_ops_xip(sector_flash_offset(sector)));
+    for (uint32_t i = 0; i < FLASH_SECTOR_SIZE / 4; ++i) {
+        if (words[i] != 0xFFFFFFFFu) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static bool sector_in_use(uint8_t sector) {
+    for (uint8_t slot = 0; slot < MACRO_LIBRARY_SLOTS; ++slot) {
+        if (g_slot_sector[slot] == sector) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Fill in a slot's info from its sector (empty if it has none).
+static void load_slot(uint8_t slot) {
+    MacroSlotInfo& info = g_slots[slot];
+    info = {};
+    MacroSlotHeader header;
+    if (g_slot_sector[slot] == MACRO_NO_SECTOR || !read_sector_header(g_slot_sector[slot], &header)) {
+        return;
+    }
+    info.length = header.length;
+    info.chord = header.chord;
+    memcpy(info.name, header.name, sizeof(info.name));
+}
+
+// Zero a sector's magic: programming only clears bits, so no erase is needed.
+static bool retire_sector(uint8_t sector) {
+    uint8_t page[FLASH_PAGE_SIZE];
+    memset(page, 0xFF, sizeof(page));
+    memset(page, 0, sizeof(uint32_t));
+    return flash_ops_program(sector_flash_offset(sector), page, FLASH_PAGE_SIZE);
+}
+
+// Sector no slot uses that still needs erasing; -1 if none.
+static int unerased_spare() {
+    for (uint8_t sector = 0; sector < MACRO_LIBRARY_SECTORS; ++sector) {
+        if (!(g_erased_sectors & (1u << sector)) && !sector_in_use(sector) &&
+            !(g_job_step == MACRO_JOB_PROGRAM && sector == g_job_sector)) {
+            return sector;
+        }
+    }
+    return -1;
+}
+
+static void erase_spare() {
+    int sector = unerased_spare();
+    if (sector >= 0 && flash_ops_erase_sector(sector_flash_offset(static_cast<uint8_t>(sector)))) {
+        g_erased_sectors = static_cast<uint16_t>(g_erased_sectors | (1u << sector));
+    }
+}
+
+void macro_library_init() {
+    memset(g_slot_sector, MACRO_NO_SECTOR, sizeof(g_slot_sector));
+    g_storage_available = flash_ops_persistent_area_free();
+    if (!g_storage_available) {
+        LOG_PRINTF("[MACRO] program image overlaps the macro library; saving disabled\n");
+        return;
+    }
+    for (uint8_t sector = 0; sector < MACRO_LIBRARY_SECTORS; ++sector) {
+        MacroSlotHeader header;
+        if (!read_sector_header(sector, &header)) {
+            continue;
+        }
+        uint8_t slot = header.slot;
+        if (g_slot_sector[slot] != MACRO_NO_SECTOR) {
+            // A save cut short before it retired the old copy: keep the newer one.
+            bool newer = static_cast<int8_t>(header.generation - g_slot_generation[slot]) > 0;
+            retire_sector(newer ? g_slot_sector[slot] : sector);
+            if (!newer) {
+                continue;
+            }
+        }
+        g_slot_sector[slot] = sector;
+        g_slot_generation[slot] = header.generation;
+    }
+    // Nothing is timing-critical yet: erase every spare now.
+    for (uint8_t sector = 0; sector < MACRO_LIBRARY_SECTORS; ++sector) {
+        if (!sector_in_use(sector) && sector_blank(sector)) {
+            g_erased_sectors = static_cast<uint16_t>(g_erased_sectors | (1u << sector));
+        }
+    }
+    for (uint8_t sector = 0; sector < MACRO_LIBRARY_SECTORS; ++sector) {
+        erase_spare();
+    }
+    for (uint8_t slot = 0; slot < MACRO_LIBRARY_SLOTS; ++slot) {
+        load_slot(slot);
+        if (g_slots[slot].length) {
+            LOG_PRINTF("[MACRO] slot %u: %.16s (%u bytes, chord 0x%04x)\n", slot, g_slots[slot].name,
+                       g_slots[slot].length, g_slots[slot].chord);
+        }
+    }
+}
+
+// Stop the player before its program's sector is retired.
+static void release_slot(uint8_t slot) {
+    if (g_slot_sector[slot] != MACRO_NO_SECTOR && macro_player_is_playing(slot_code(slot))) {
+        macro_player_stop();
+    }
+}
+
+static MacroResult check_slot(uint8_t slot) {
+    if (slot >= MACRO_LIBRARY_SLOTS) {
+        return MACRO_ERR_RANGE;
+    }
+    if (!g_storage_available) {
+        return MACRO_ERR_FLASH;
+    }
+    return g_job_step != MACRO_JOB_NONE || g_job_done ? MACRO_ERR_BUSY : MACRO_OK;
+}
+
+// Empty the slot until the job lands, so neither a chord nor the host can start it mid-write.
+static void start_job(uint8_t slot, uint32_t length, MacroJobStep step) {
+    release_slot(slot);
+    g_slots[slot] = {};
+    g_job_slot = slot;
+    g_job_length = length;
+    g_job_step = step;
+}
+
+MacroResult macro_library_save(uint8_t slot, uint16_t length, uint16_t chord, const char* name, uint8_t name_length) {
+    MacroResult status = check_slot(slot);
+    if (status != MACRO_OK) {
+        return status;
+    }
+    if (length > MACRO_SLOT_SIZE) {
+        return MACRO_ERR_RANGE;
+    }
+    const uint8_t* code = macro_player_slot();
+    bool single_button_chord = chord != 0 && (chord & (chord - 1)) == 0;
+    if (!macro_validate(code, length) || single_button_chord) {
+        return MACRO_ERR_INVALID;  // a one-button chord would swallow that button entirely
+    }
+    int target = -1;
+    for (uint8_t sector = 0; sector < MACRO_LIBRARY_SECTORS && target < 0; ++sector) {
+        if (g_erased_sectors & (1u << sector)) {
+            target = sector;
+        }
+    }
+    if (target < 0) {
+        return MACRO_ERR_BUSY;  // every spare was used this session; they are erased again once USB is idle
+    }
+
+    MacroSlotHeader header{};
+    header.magic = MACRO_SLOT_MAGIC;
+    header.length = length;
+    header.chord = chord;
+    header.slot = slot;
+    header.generation = static_cast<uint8_t>(g_slot_generation[slot] + 1);
+    header.reserved = 0xFFFF;
+    memset(header.name, 0, sizeof(header.name));
+    memcpy(header.name, name, name_length < MACRO_NAME_LENGTH ? name_length : MACRO_NAME_LENGTH);
+    header.checksum = slot_checksum(header, code);
+    memcpy(g_job_image, &header, sizeof(header));
+    memcpy(g_job_image + sizeof(header), code, length);
+
+    g_job_sector = static_cast<uint8_t>(target);
+    g_erased_sectors = static_cast<uint16_t>(g_erased_sectors & ~(1u << target));
+    g_job_page = (sizeof(header) + length - 1) / FLASH_PAGE_SIZE * FLASH_PAGE_SIZE;
+    start_job(slot, sizeof(header) + length, MACRO_JOB_PROGRAM);
+    return MACRO_OK;
+}
+
+MacroResult macro_library_delete(uint8_t slot) {
+    MacroResult status = check_slot(slot);
+    if (status != MACRO_OK) {
+        return status;
+    }
+    start_job(slot, 0, MACRO_JOB_RETIRE);
+    return MACRO_OK;
+}
+
+static void finish_job(MacroResult result) {
+    g_job_step = MACRO_JOB_NONE;
+    load_slot(g_job_slot);  // the old copy again if the save failed
+    g_job_result = result;
+    g_job_done = true;
+    LOG_PRINTF("[MACRO] %s slot %u -> %u\n", g_job_length ? "saved" : "deleted", g_job_slot, result);
+}
+
+// Retire the slot's old sector and point the slot at the new one (if any).
+static void commit_job() {
+    uint8_t old_sector = g_slot_sector[g_job_slot];
+    if (old_sector != MACRO_NO_SECTOR && !retire_sector(old_sector)) {
+        // A delete that failed leaves the slot; a save is in flash either way
+        // and wins at boot on its generation.
+        if (!g_job_length) {
+            finish_job(MACRO_ERR_FLASH);
+            return;
+        }
+    }
+    if (g_job_length) {
+        g_slot_sector[g_job_slot] = g_job_sector;
+        g_slot_generation[g_job_slot]++;
+    } else {
+        g_slot_sector[g_job_slot] = MACRO_NO_SECTOR;
+    }
+    finish_job(MACRO_OK);
+}
+
+void macro_library_task(absolute_time_t report_deadline, bool usb_active) {
+    g_usb_active = usb_active;
+    if (!g_storage_available) {
+        return;
+    }
+    if (g_job_step == MACRO_JOB_NONE) {
+        if (!usb_active) {
+            erase_spare();  // nobody is waiting on reports
+        }
+        return;
+    }
+    if (usb_active && absolute_time_diff_us(get_absolute_time(), report_deadline) < MACRO_FLASH_BUDGET_US) {
+        return;  // right after the next report goes out
+    }
+    if (g_job_step == MACRO_JOB_RETIRE) {
+        commit_job();
+        return;
+    }
+
+    // Pages after the first go in first; the header page last, so a save cut
+    // short by power loss leaves no valid header rather than a truncated macro.
+    uint8_t page[FLASH_PAGE_SIZE];
+    memset(page, 0xFF, sizeof(page));
+    uint32_t chunk = g_job_length - g_job_page < FLASH_PAGE_SIZE ? g_job_length - g_job_page : FLASH_PAGE_SIZE;
+    memcpy(page, g_job_image + g_job_page, chunk);
+    if (!flash_ops_program(sector_flash_offset(g_job_sector) + g_job_page, page, FLASH_PAGE_SIZE)) {
+        finish_job(MACRO_ERR_FLASH);  // the target is erased again once USB is idle
+    } else if (g_job_page > 0) {
+        g_job_page -= FLASH_PAGE_SIZE;
+    } else {
+        MacroSlotHeader header;
+        if (!read_sector_header(g_job_sector, &header)) {
+            finish_job(MACRO_ERR_FLASH);  // read back wrong
+        } else {
+            g_job_step = MACRO_JOB_RETIRE;
+        }
+    }
+}
+
+absolute_time_t macro_library_next_task_time() {
+    if (g_job_step != MACRO_JOB_NONE || (g_storage_available && !g_usb_active && unerased_spare() >= 0)) {
+        return get_absolute_time();
+    }
+    return at_the_end_of_time;
+}
+
+bool macro_library_take_result(MacroResult* result) {
+    if (!g_job_done) {
+        return false;
+    }
+    g_job_done = false;
+    *result = g_job_result;
+    return true;
+}
+
+MacroResult macro_library_play(uint8_t slot) {
+    if (slot >= MACRO_LIBRARY_SLOTS) {
+        return MACRO_ERR_RANGE;
+    }
+    if (g_slots[slot].length == 0) {
+        return MACRO_ERR_EMPTY;
+    }
+    return macro_player_start(slot_code(slot), g_slots[slot].length);
+}
+
+bool macro_library_info(uint8_t slot, MacroSlotInfo* out) {
+    if (slot >= MACRO_LIBRARY_SLOTS) {
+        return false;
+    }
+    *out = g_slots[slot];
+    return true;
+}
+
+uint8_t macro_library_playing_slot() {
+    for (uint8_t slot = 0; slot < MACRO_LIBRARY_SLOTS; ++slot) {
+        if (g_slots[slot].length && macro_player_is_playing(slot_code(slot))) {
+            return slot;
+        }
+    }
+    return 0xFF;
+}
+
+void __not_in_flash_func(macro_library_apply)(SwitchInputState* state, bool new_report) {
+    uint16_t buttons = switch_input_buttons(*state);
+    if (new_report) {
+        if (g_held_chord && (buttons & g_held_chord) != g_held_chord) {
+            g_held_chord = 0;  // chord released; its buttons reach the console again
+        }
+        if (!g_held_chord) {
+            // Prefer the chord with the most buttons when several match.
+            uint8_t best = 0xFF;
+            for (uint8_t slot = 0; slot < MACRO_LIBRARY_SLOTS; ++slot) {
+                uint16_t chord = g_slots[slot].chord;
+                if (g_slots[slot].length && chord && (buttons & chord) == chord &&
+                    (best == 0xFF || __builtin_popcount(chord) > __builtin_popcount(g_slots[best].chord))) {
+                    best = slot;
+                }
+            }
+            if (best != 0xFF) {
+                g_held_chord = g_slots[best].chord;
+                if (macro_library_playing_slot() == best) {
+                    macro_player_stop();
+                } else {
+                    macro_library_play(best);
+                }
+            }
+        }
+    }
+    if (g_held_chord) {
+        switch_input_set_buttons(state, static_cast<uint16_t>(buttons & ~g_held_chord));
+    }
+}
@@ -0,0 +1,58 @@
+/*
+ * Named macros kept in the Pico's flash (see flash_layout.h), one per slot.
+ * Saved programs are played straight from XIP flash without copying. A slot
+ * can be started from the host, or by a button chord in the host's input:
+ * pressing the chord starts the slot's macro and pressing it again while
+ * it runs stops it. Chord buttons are hidden from the console while held.
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "flash_layout.h"
+#include "macro_player.h"
+#include "pico/time.h"
+
+#define MACRO_NAME_LENGTH 16
+
+typedef struct {
+    uint16_t length;  // 0 = empty slot
+    uint16_t chord;   // SWITCH_PRO_MASK_* bits, 0 = no chord
+    char name[MACRO_NAME_LENGTH];  // not NUL terminated when all 16 are used
+} MacroSlotInfo;
+
+// Index the saved slots. Call on core 0 before core 1 is launched.
+void macro_library_init();
+
+// Stage the first length bytes of the player's RAM slot for storing. A chord
+// needs at least two buttons. MACRO_OK means staged: macro_library_task()
+// writes it and macro_library_take_result() reports the outcome. One save or
+// delete at a time; the slot reads empty meanwhile. MACRO_ERR_BUSY also means
+// no erased spare sector is left until USB next goes idle.
+MacroResult macro_library_save(uint8_t slot, uint16_t length, uint16_t chord, const char* name, uint8_t name_length);
+
+// Stage emptying a slot, like macro_library_save().
+MacroResult macro_library_delete(uint8_t slot);
+
+// Run one page program of a staged save or delete; while usb_active (mounted
+// and not suspended), only when report_deadline leaves room for it. Sectors
+// are only erased while it is false, so the library never holds back a report.
+void macro_library_task(absolute_time_t report_deadline, bool usb_active);
+
+// When macro_library_task() next has work (at_the_end_of_time if none).
+absolute_time_t macro_library_next_task_time();
+
+// Outcome of a staged save or delete that finished since the last call.
+bool macro_library_take_result(MacroResult* result);
+
+// Start a saved macro from flash.
+MacroResult macro_library_play(uint8_t slot);
+
+bool macro_library_info(uint8_t slot, MacroSlotInfo* out);
+
+// Library slot being played, or 0xFF if none (or the RAM slot is playing).
+uint8_t macro_library_playing_slot();
+
+// Report filter stage, ahead of macro_player_apply(): watch for chords.
+void macro_library_apply(SwitchInputState* state, bool new_report);
@@ -0,0 +1,306 @@
+#include "macro_player.h"
+
+#include <stdio.h>
+#include <string.h>
+#include "pico/platform.h"
+#include "pico/time.h"
+
+#ifdef SWITCH_PICO_LOG
+#define LOG_PRINTF(...) printf(__VA_ARGS__)
+#else
+#define LOG_PRINTF(...) ((void)0)
+#endif
+
+typedef struct {
+    uint16_t body_pc;    // first instruction after LOOP
+    uint16_t remaining;  // 0 = forever
+} MacroLoop;
+
+static uint8_t g_slot[MACRO_SLOT_SIZE];
+
+static const uint8_t* g_program = nullptr;
+static uint16_t g_length = 0;
+static uint16_t g_pc = 0;
+static MacroState g_state = MACRO_STATE_IDLE;
+static MacroLoop g_loops[MACRO_LOOP_DEPTH];
+static uint8_t g_loop_depth = 0;
+static uint16_t g_wait_reports = 0;
+static uint32_t g_wait_until_us = 0;
+static bool g_waiting_us = false;
+
+// Output overlaid on the host's input.
+static uint16_t g_buttons = 0;
+static uint8_t g_hat = SWITCH_PRO_HAT_NOTHING;
+static bool g_left_set = false;
+static bool g_right_set = false;
+static uint8_t g_left[2];
+static uint8_t g_right[2];
+
+// Instruction length including the opcode, or 0 for an unknown opcode.
+static uint8_t op_size(uint8_t op) {
+    switch (op) {
+        case MACRO_OP_END:
+        case MACRO_OP_ENDLOOP:
+        case MACRO_OP_NEUTRAL:
+            return 1;
+        case MACRO_OP_HAT:
+            return 2;
+        case MACRO_OP_PRESS:
+        case MACRO_OP_RELEASE:
+        case MACRO_OP_LSTICK:
+        case MACRO_OP_RSTICK:
+        case MACRO_OP_WAIT_REPORTS:
+        case MACRO_OP_LOOP:
+        case MACRO_OP_JUMP:
+            return 3;
+        case MACRO_OP_WAIT_US:
+            return 5;
+        default:
+            return 0;
+    }
+}
+
+static uint16_t read_u16(const uint8_t* p) {
+    return static_cast<uint16_t>(p[0] | (p[1] << 8));
+}
+
+static uint32_t read_u32(const uint8_t* p) {
+    return p[0] | (p[1] << 8) | (p[2] << 16) | (static_cast<uint32_t>(p[3]) << 24);
+}
+
+#define MACRO_TOP_LEVEL 0xFFFF  // enclosing-loop value outside every LOOP
+
+// Walk the instructions before `target` and report the LOOP whose body holds
+// it. False when target is not an instruction boundary.
+static bool enclosing_loop(const uint8_t* program, uint16_t target, uint16_t* loop_pc) {
+    uint16_t open[MACRO_LOOP_DEPTH];
+    uint8_t depth = 0;
+    uint16_t pc = 0;
+    while (pc < target) {
+        if (program[pc] == MACRO_OP_LOOP) {
+            open[depth++] = pc;
+        } else if (program[pc] == MACRO_OP_ENDLOOP) {
+            depth--;
+        }
+        pc = static_cast<uint16_t>(pc + op_size(program[pc]));
+    }
+    *loop_pc = depth > 0 ? open[depth - 1] : MACRO_TOP_LEVEL;
+    return pc == target;
+}
+
+bool macro_validate(const uint8_t* program, uint16_t length) {
+    if (!program || length == 0 || length > 0xFFF0) {
+        return false;
+    }
+    // Two passes: walk the instructions and match LOOP/ENDLOOP, then check each
+    // jump lands on an instruction in the same loop body it starts from.
+    for (int pass = 0; pass < 2; ++pass) {
+        uint16_t open[MACRO_LOOP_DEPTH];
+        uint8_t depth = 0;
+        uint16_t pc = 0;
+        while (pc < length) {
+            uint8_t size = op_size(program[pc]);
+            if (size == 0 || pc + size > length) {
+                return false;
+            }
+            if (program[pc] == MACRO_OP_LOOP) {
+                if (depth >= MACRO_LOOP_DEPTH) {
+                    return false;
+                }
+                open[depth++] = pc;
+            } else if (program[pc] == MACRO_OP_ENDLOOP) {
+                if (depth == 0) {
+                    return false;
+                }
+                depth--;
+            } else if (pass == 1 && program[pc] == MACRO_OP_JUMP) {
+                uint16_t target = read_u16(&program[pc + 1]);
+                uint16_t target_loop;
+                if (target >= length || !enclosing_loop(program, target, &target_loop) ||
+                    target_loop != (depth > 0 ? open[depth - 1] : MACRO_TOP_LEVEL)) {
+                    return false;
+                }
+            }
+            pc = static_cast<uint16_t>(pc + size);
+        }
+        if (depth != 0) {
+            return false;  // LOOP without ENDLOOP
+        }
+    }
+    return true;
+}
+
+static void release_all() {
+    g_buttons = 0;
+    g_hat = SWITCH_PRO_HAT_NOTHING;
+    g_left_set = false;
+    g_right_set = false;
+}
+
+void macro_player_stop() {
+    g_state = MACRO_STATE_IDLE;
+    release_all();
+}
+
+MacroResult macro_player_upload(uint16_t offset, const uint8_t* data, uint8_t length) {
+    if (g_state == MACRO_STATE_RUNNING && g_program == g_slot) {
+        return MACRO_ERR_BUSY;
+    }
+    if (static_cast<uint32_t>(offset) + length > sizeof(g_slot)) {
+        return MACRO_ERR_RANGE;
+    }
+    memcpy(&g_slot[offset], data, length);
+    return MACRO_OK;
+}
+
+MacroResult macro_player_start(const uint8_t* program, uint16_t length) {
+    if (!macro_validate(program, length)) {
+        return MACRO_ERR_INVALID;
+    }
+    release_all();
+    g_program = program;
+    g_length = length;
+    g_pc = 0;
+    g_loop_depth = 0;
+    g_wait_reports = 0;
+    g_waiting_us = false;
+    g_state = MACRO_STATE_RUNNING;
+    return MACRO_OK;
+}
+
+MacroResult macro_player_start_uploaded(uint16_t length) {
+    if (length > sizeof(g_slot)) {
+        return MACRO_ERR_RANGE;
+    }
+    return macro_player_start(g_slot, length);
+}
+
+const uint8_t* macro_player_slot() {
+    return g_slot;
+}
+
+bool macro_player_is_playing(const uint8_t* program) {
+    return g_state == MACRO_STATE_RUNNING && g_program == program;
+}
+
+MacroState macro_player_state() {
+    return g_state;
+}
+
+uint16_t macro_player_pc() {
+    return g_pc;
+}
+
+static void fault(const char* reason) {
+    (void)reason;
+    LOG_PRINTF("[MACRO] fault at 0x%03x: %s\n", g_pc, reason);
+    release_all();
+    g_state = MACRO_STATE_FAULTED;
+}
+
+// Run instructions until the program waits, ends or uses up its step budget.
+static void __not_in_flash_func(step)(uint32_t now_us) {
+    if (g_wait_reports > 0 && --g_wait_reports > 0) {
+        return;
+    }
+    if (g_waiting_us) {
+        if (static_cast<int32_t>(now_us - g_wait_until_us) < 0) {
+            return;
+        }
+        g_waiting_us = false;
+    }
+
+    for (uint8_t steps = 0; steps < MACRO_STEPS_PER_REPORT; ++steps) {
+        if (g_pc >= g_length) {
+            macro_player_stop();
+            return;
+        }
+        const uint8_t* op = &g_program[g_pc];
+        g_pc = static_cast<uint16_t>(g_pc + op_size(op[0]));
+        switch (op[0]) {
+            case MACRO_OP_END:
+                macro_player_stop();
+                return;
+            case MACRO_OP_PRESS:
+                g_buttons |= read_u16(op + 1);
+                break;
+            case MACRO_OP_RELEASE:
+                g_buttons &= static_cast<uint16_t>(~read_u16(op + 1));
+                break;
+            case MACRO_OP_HAT:
+                g_hat = op[1];
+                break;
+            case MACRO_OP_LSTICK:
+                g_left[0] = op[1];
+                g_left[1] = op[2];
+                g_left_set = true;
+                break;
+            case MACRO_OP_RSTICK:
+                g_right[0] = op[1];
+                g_right[1] = op[2];
+                g_right_set = true;
+                break;
+            case MACRO_OP_WAIT_US:
+                g_wait_until_us = now_us + read_u32(op + 1);
+                g_waiting_us = true;
+                return;
+            case MACRO_OP_WAIT_REPORTS:
+                g_wait_reports = read_u16(op + 1);
+                if (g_wait_reports > 0) {
+                    return;
+                }
+                break;
+            case MACRO_OP_LOOP:
+                if (g_loop_depth >= MACRO_LOOP_DEPTH) {
+                    fault("loops nested too deep");
+                    return;
+                }
+                g_loops[g_loop_depth++] = {g_pc, read_u16(op + 1)};
+                break;
+            case MACRO_OP_ENDLOOP: {
+                if (g_loop_depth == 0) {
+                    fault("ENDLOOP without LOOP");
+                    return;
+                }
+                MacroLoop& loop = g_loops[g_loop_depth - 1];
+                if (loop.remaining == 0 || --loop.remaining > 0) {
+                    g_pc = loop.body_pc;
+                } else {
+                    g_loop_depth--;
+                }
+                break;
+            }
+            case MACRO_OP_JUMP:
+                g_pc = read_u16(op + 1);
+                break;
+            case MACRO_OP_NEUTRAL:
+                release_all();
+                break;
+        }
+    }
+}
+
+void __not_in_flash_func(macro_player_apply)(SwitchInputState* state, bool new_report) {
+    if (g_state != MACRO_STATE_RUNNING) {
+        return;
+    }
+    if (new_report) {
+        step(time_us_32());
+    }
+
+    switch_input_set_buttons(state, switch_input_buttons(*state) | g_buttons);
+    if (g_hat != SWITCH_PRO_HAT_NOTHING) {
+        switch_input_set_hat(state, g_hat);
+    }
+    auto expand_axis = [](uint8_t v) -> uint16_t {
+        return static_cast<uint16_t>(v) << 8 | v;
+    };
+    if (g_left_set) {
+        state->lx = expand_axis(g_left[0]);
+        state->ly = expand_axis(g_left[1]);
+    }
+    if (g_right_set) {
+        state->rx = expand_axis(g_right[0]);
+        state->ry = expand_axis(g_right[1]);
+    }
+}
@@ -0,0 +1,93 @@
+/*
+ * On-device macro playback. A macro is a small bytecode program that presses
+ * buttons, moves sticks and waits; it is stepped from the driver's report
+ * filter, so every action lands on an exact input report instead of depending
+ * on host scheduling. Macro input is overlaid on the host's input: pressed
+ * buttons are ORed in, and a set hat or stick replaces the host's.
+ *
+ * Bytecode (operands little endian):
+ *
+ *   0x00 END                     release everything and stop
+ *   0x01 PRESS     buttons(u16)  SWITCH_PRO_MASK_* bits to hold
+ *   0x02 RELEASE   buttons(u16)
+ *   0x03 HAT       hat(u8)       SWITCH_PRO_HAT_*; HAT_NOTHING hands the dpad back
+ *   0x04 LSTICK    x(u8) y(u8)   0-255, 128 = centre
+ *   0x05 RSTICK    x(u8) y(u8)
+ *   0x06 WAIT_US   us(u32)       until the first report at least this much later
+ *   0x07 WAIT      reports(u16)  keep the current output for this many reports
+ *   0x08 LOOP      count(u16)    repeat up to the matching ENDLOOP; 0 = forever
+ *   0x09 ENDLOOP
+ *   0x0A JUMP      offset(u16)   absolute; must not leave an enclosing LOOP
+ *   0x0B NEUTRAL                 release all buttons, hat and sticks
+ *
+ * Running off the end of the program is the same as END.
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "switch_pro_driver.h"
+
+#define MACRO_SLOT_SIZE 1024   // RAM slot for uploaded programs
+#define MACRO_LOOP_DEPTH 4
+#define MACRO_STEPS_PER_REPORT 64  // a wait-free loop yields after this many instructions
+
+typedef enum {
+    MACRO_OP_END = 0x00,
+    MACRO_OP_PRESS = 0x01,
+    MACRO_OP_RELEASE = 0x02,
+    MACRO_OP_HAT = 0x03,
+    MACRO_OP_LSTICK = 0x04,
+    MACRO_OP_RSTICK = 0x05,
+    MACRO_OP_WAIT_US = 0x06,
+    MACRO_OP_WAIT_REPORTS = 0x07,
+    MACRO_OP_LOOP = 0x08,
+    MACRO_OP_ENDLOOP = 0x09,
+    MACRO_OP_JUMP = 0x0A,
+    MACRO_OP_NEUTRAL = 0x0B,
+} MacroOpcode;
+
+typedef enum {
+    MACRO_STATE_IDLE = 0,
+    MACRO_STATE_RUNNING = 1,
+    MACRO_STATE_FAULTED = 2,  // loop stack misuse at runtime; stopped
+} MacroState;
+
+typedef enum {
+    MACRO_OK = 0,
+    MACRO_ERR_RANGE = 1,    // upload outside the RAM slot
+    MACRO_ERR_INVALID = 2,  // program failed validation
+    MACRO_ERR_BUSY = 3,     // the RAM slot is being played
+    MACRO_ERR_FLASH = 4,    // library storage unavailable or a flash write failed
+    MACRO_ERR_EMPTY = 5,    // no macro saved in that library slot
+} MacroResult;
+
+// Check that every opcode is known, operands are complete, every LOOP has its
+// ENDLOOP within MACRO_LOOP_DEPTH, and each JUMP lands on an instruction in
+// the loop body it starts from.
+bool macro_validate(const uint8_t* program, uint16_t length);
+
+// Write part of the RAM slot.
+MacroResult macro_player_upload(uint16_t offset, const uint8_t* data, uint8_t length);
+
+// Validate and start the first length bytes of the RAM slot.
+MacroResult macro_player_start_uploaded(uint16_t length);
+
+// Validate and start a program anywhere in memory; it must stay valid while it runs.
+MacroResult macro_player_start(const uint8_t* program, uint16_t length);
+
+// Stop and release everything the macro holds.
+void macro_player_stop();
+
+// The RAM slot, for saving an uploaded program elsewhere.
+const uint8_t* macro_player_slot();
+
+// True while the given program is the one being played.
+bool macro_player_is_playing(const uint8_t* program);
+
+MacroState macro_player_state();
+uint16_t macro_player_pc();
+
+// Report filter stage: step the program once per new report, then overlay its output.
+void macro_player_apply(SwitchInputState* state, bool new_report);
@@ -0,0 +1,80 @@
+#include "pio_serial_rx.h"
+
+#include "hardware/dma.h"
+#include "hardware/pio.h"
+#include "pico/platform.h"
+#include "serial_rx.pio.h"
+
+#define PIO_RX_RING_BITS 10
+#define PIO_RX_RING_SIZE (1u << PIO_RX_RING_BITS)
+
+// The DMA write address wraps inside this buffer, so it must be aligned to its size.
+static uint8_t g_rx_ring[PIO_RX_RING_SIZE] __attribute__((aligned(PIO_RX_RING_SIZE)));
+static uint32_t g_rx_tail = 0;  // free-running read count
+static uint32_t g_rx_head = 0;  // free-running write count
+static uint32_t g_rx_armed_base = 0;  // write count when the DMA channel was last armed
+static uint32_t g_rx_overruns = 0;
+static int g_dma_channel = -1;
+
+void pio_serial_rx_init(int mode, unsigned data_pin, unsigned baud) {
+    PIO pio = pio0;
+    uint sm = pio_claim_unused_sm(pio, true);
+    if (mode == PIO_SERIAL_RX_MODE_CLOCKED) {
+        uint offset = pio_add_program(pio, &serial_clocked_rx_program);
+        serial_clocked_rx_program_init(pio, sm, offset, data_pin);
+    } else {
+        uint offset = pio_add_program(pio, &serial_uart_rx_program);
+        serial_uart_rx_program_init(pio, sm, offset, data_pin, baud);
+    }
+
+    g_dma_channel = dma_claim_unused_channel(true);
+    dma_channel_config c = dma_channel_get_default_config(g_dma_channel);
+    channel_config_set_transfer_data_size(&c, DMA_SIZE_8);
+    channel_config_set_read_increment(&c, false);
+    channel_config_set_write_increment(&c, true);
+    channel_config_set_ring(&c, true, PIO_RX_RING_BITS);
+    channel_config_set_dreq(&c, pio_get_dreq(pio, sm, false));
+
+    // The received byte sits in bits 31:24 of the FIFO word.
+    const volatile uint8_t* rx_byte = reinterpret_cast<const volatile uint8_t*>(&pio->rxf[sm]) + 3;
+    dma_channel_configure(g_dma_channel, &c, g_rx_ring, rx_byte, 0xFFFFFFFFu, true);
+}
+
+size_t __not_in_flash_func(pio_serial_rx_read)(uint8_t* out, size_t max_len) {
+    if (g_dma_channel < 0) {
+        return 0;
+    }
+    dma_channel_hw_t* hw = dma_channel_hw_addr(g_dma_channel);
+
+    // Bytes written so far follow from how far the transfer count has run
+    // down, which (unlike the wrapped write address) also reveals a lap.
+    uint32_t remaining = hw->transfer_count;
+    g_rx_head = g_rx_armed_base + (0xFFFFFFFFu - remaining);
+    if (remaining == 0) {
+        // Exhausted after 2^32-1 bytes: re-arm so the ring keeps filling. The
+        // joined 8-deep PIO FIFO covers the gap.
+        g_rx_armed_base = g_rx_head;
+        hw->al1_transfer_count_trig = 0xFFFFFFFFu;
+    }
+
+    uint32_t available = g_rx_head - g_rx_tail;
+    if (available > PIO_RX_RING_SIZE) {
+        // Lapped by DMA. Skip to the newest half ring, clear of bytes DMA is
+        // still overwriting, and let the frame parser resync on the next marker.
+        uint32_t keep = PIO_RX_RING_SIZE / 2;
+        g_rx_overruns += available - keep;
+        g_rx_tail = g_rx_head - keep;
+        available = keep;
+    }
+
+    size_t count = available < max_len ? available : max_len;
+    for (size_t i = 0; i < count; ++i) {
+        out[i] = g_rx_ring[(g_rx_tail + i) & (PIO_RX_RING_SIZE - 1)];
+    }
+    g_rx_tail += count;
+    return count;
+}
+
+uint32_t pio_serial_rx_overruns() {
+    return g_rx_overruns;
+}
@@ -0,0 +1,25 @@
+/*
+ * Optional second input link built on a PIO state machine. Bytes are moved
+ * into a RAM ring by DMA with no CPU involvement; the owner drains the ring
+ * and feeds the same frame parser as UART1.
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define PIO_SERIAL_RX_MODE_UART 0
+#define PIO_SERIAL_RX_MODE_CLOCKED 1
+
+// Claim a state machine and DMA channel and start receiving. In UART mode
+// data_pin is RX at the given baud; in clocked mode data_pin is data and
+// data_pin + 1 is the host's clock (baud is ignored).
+void pio_serial_rx_init(int mode, unsigned data_pin, unsigned baud);
+
+// Copy up to max_len bytes received since the last call into out. Returns the
+// number copied. Call from a single context only.
+size_t pio_serial_rx_read(uint8_t* out, size_t max_len);
+
+// Bytes lost because the ring wrapped before they were read.
+uint32_t pio_serial_rx_overruns();
@@ -0,0 +1,62 @@
+/*
+ * Versioned single-writer snapshot for passing whole structs between cores or
+ * from an IRQ to thread code. The writer never blocks; readers copy the value
+ * and retry if the sequence moved underneath them (odd = write in progress).
+ *
+ * Each instance must have exactly one writer. Give every producer its own
+ * slot rather than sharing one. A reader must not preempt the writer on the
+ * same core (e.g. reading from an IRQ that can interrupt write()), or it
+ * would spin on the odd sequence forever.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include "hardware/sync.h"
+
+template <typename T>
+class SeqlockSnapshot {
+public:
+    constexpr SeqlockSnapshot() : sequence_(0), value_{} {}
+    constexpr explicit SeqlockSnapshot(const T& initial) : sequence_(0), value_(initial) {}
+
+    void write(const T& value) {
+        uint32_t sequence = sequence_;
+        sequence_ = sequence + 1;
+        __dmb();
+        value_ = value;
+        __dmb();
+        sequence_ = sequence + 2;
+    }
+
+    // Copy the latest consistent value into *out and return its sequence.
+    uint32_t read(T* out) const {
+        while (true) {
+            uint32_t begin = sequence_;
+            if (begin & 1u) {
+                continue;  // writer is mid-copy; it finishes within a few hundred cycles
+            }
+            __dmb();
+            *out = value_;
+            __dmb();
+            if (sequence_ == begin) {
+                return begin;
+            }
+        }
+    }
+
+    // Copy only if something was written since *last_sequence; updates it on success.
+    bool read_if_newer(uint32_t* last_sequence, T* out) const {
+        if (sequence_ == *last_sequence) {
+            return false;
+        }
+        *last_sequence = read(out);
+        return true;
+    }
+
+    uint32_t sequence() const { return sequence_; }
+
+private:
+    volatile uint32_t sequence_;
+    T value_;
+};
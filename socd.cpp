@@ -0,0 +1,70 @@
+#include "socd.h"
+
+#include "pico/platform.h"
+
+// Press order per direction: the pass counter when the direction went down,
+// so "most recent" never depends on clock resolution and directions pressed
+// in the same input frame tie.
+typedef struct {
+    bool held;
+    uint32_t pressed_at;
+} SocdDirection;
+
+static SocdMode g_mode = SOCD_NEUTRAL;
+static uint32_t g_pass = 0;
+static SocdDirection g_up, g_down, g_left, g_right;
+
+bool socd_set_mode(uint8_t mode) {
+    if (mode > SOCD_UP_PRIORITY) {
+        return false;
+    }
+    g_mode = static_cast<SocdMode>(mode);
+    return true;
+}
+
+SocdMode socd_mode() {
+    return g_mode;
+}
+
+static void __not_in_flash_func(track)(SocdDirection* direction, bool held) {
+    if (held && !direction->held) {
+        direction->pressed_at = g_pass;
+    }
+    direction->held = held;
+}
+
+// Settle one axis when both of its directions are held.
+static void __not_in_flash_func(resolve)(bool* first, bool* second, const SocdDirection& a, const SocdDirection& b,
+                                         SocdMode mode) {
+    if (!*first || !*second) {
+        return;
+    }
+    switch (mode) {
+        case SOCD_LAST_INPUT:
+            // Pressed in the same frame: neither is more recent.
+            *first = static_cast<int32_t>(a.pressed_at - b.pressed_at) > 0;
+            *second = static_cast<int32_t>(b.pressed_at - a.pressed_at) > 0;
+            break;
+        case SOCD_UP_PRIORITY:  // only used for the vertical axis, with first = up
+            *second = false;
+            break;
+        default:
+            *first = *second = false;
+            break;
+    }
+}
+
+void __not_in_flash_func(socd_apply)(SwitchInputState* state) {
+    // Track edges even when off, so switching modes mid-hold behaves.
+    g_pass++;
+    track(&g_up, state->dpad_up);
+    track(&g_down, state->dpad_down);
+    track(&g_left, state->dpad_left);
+    track(&g_right, state->dpad_right);
+    if (g_mode == SOCD_OFF) {
+        return;
+    }
+    resolve(&state->dpad_up, &state->dpad_down, g_up, g_down, g_mode);
+    resolve(&state->dpad_left, &state->dpad_right, g_left, g_right,
+            g_mode == SOCD_UP_PRIORITY ? SOCD_NEUTRAL : g_mode);
+}
@@ -0,0 +1,26 @@
+/*
+ * SOCD (simultaneous opposing cardinal directions) cleaning for the dpad.
+ * Hitbox-style sources send raw directions (see UART_HAT_RAW in
+ * uart_protocol.h) and can hold left and right, or up and down, together;
+ * this stage decides what the console sees. Constant time per report.
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "switch_pro_driver.h"
+
+typedef enum {
+    SOCD_OFF = 0,          // pass opposing directions through
+    SOCD_LAST_INPUT = 1,   // the direction pressed most recently wins
+    SOCD_NEUTRAL = 2,      // opposing directions cancel out
+    SOCD_UP_PRIORITY = 3,  // up beats down; left + right cancel out
+} SocdMode;
+
+// Returns false for an unknown mode.
+bool socd_set_mode(uint8_t mode);
+SocdMode socd_mode();
+
+// Report filter stage; runs on the host's input, ahead of everything else.
+void socd_apply(SwitchInputState* state);
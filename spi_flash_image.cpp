@@ -0,0 +1,137 @@
+#include "spi_flash_image.h"
+
+#include <string.h>
+#include "pico/platform.h"
+
+#ifdef SWITCH_PICO_SPI_IMAGE
+#include "spi_image_pages.h"
+#endif
+
+typedef struct {
+    const uint8_t* data;  // nullptr: erased
+    uint16_t length;
+} SpiFlashPage;
+
+static SpiFlashPage g_pages[SPI_FLASH_PAGE_COUNT];
+static uint8_t g_ram_pages[SPI_FLASH_RAM_PAGES][SPI_FLASH_PAGE_SIZE];
+static uint8_t g_ram_pages_used = 0;
+// Which page each RAM slot backs, and the constant data it was copied from.
+static SpiFlashRamPage g_ram_page_info[SPI_FLASH_RAM_PAGES];
+
+void spi_flash_image_init() {
+    memset(g_pages, 0, sizeof(g_pages));
+    g_ram_pages_used = 0;
+#ifdef SWITCH_PICO_SPI_IMAGE
+    for (const SpiFlashConstPage& page : spi_image_pages) {
+        spi_flash_map_const(page.address, page.data, page.length);
+    }
+#endif
+}
+
+void spi_flash_map_const(uint32_t address, const uint8_t* data, uint16_t length) {
+    if (address >= SPI_FLASH_SIZE) {
+        return;
+    }
+    SpiFlashPage& page = g_pages[address / SPI_FLASH_PAGE_SIZE];
+    page.data = data;
+    page.length = length > SPI_FLASH_PAGE_SIZE ? SPI_FLASH_PAGE_SIZE : length;
+}
+
+bool spi_flash_is_mapped(uint32_t address) {
+    return address < SPI_FLASH_SIZE && g_pages[address / SPI_FLASH_PAGE_SIZE].data != nullptr;
+}
+
+void __not_in_flash_func(spi_flash_read)(uint32_t address, uint8_t* dest, uint32_t size) {
+    while (size > 0) {
+        if (address >= SPI_FLASH_SIZE) {
+            memset(dest, 0xFF, size);
+            return;
+        }
+        const SpiFlashPage& page = g_pages[address / SPI_FLASH_PAGE_SIZE];
+        uint32_t offset = address % SPI_FLASH_PAGE_SIZE;
+        uint32_t chunk = SPI_FLASH_PAGE_SIZE - offset;
+        if (chunk > size) {
+            chunk = size;
+        }
+        uint32_t present = 0;
+        if (page.data && offset < page.length) {
+            present = page.length - offset;
+            if (present > chunk) {
+                present = chunk;
+            }
+            memcpy(dest, page.data + offset, present);
+        }
+        memset(dest + present, 0xFF, chunk - present);
+        address += chunk;
+        dest += chunk;
+        size -= chunk;
+    }
+}
+
+uint8_t* spi_flash_page_for_write(uint32_t address) {
+    if (address >= SPI_FLASH_SIZE) {
+        return nullptr;
+    }
+    SpiFlashPage& page = g_pages[address / SPI_FLASH_PAGE_SIZE];
+    for (uint8_t i = 0; i < g_ram_pages_used; ++i) {
+        if (page.data == g_ram_pages[i]) {
+            return g_ram_pages[i];
+        }
+    }
+    if (g_ram_pages_used >= SPI_FLASH_RAM_PAGES) {
+        return nullptr;
+    }
+    uint32_t page_address = address - address % SPI_FLASH_PAGE_SIZE;
+    SpiFlashRamPage& info = g_ram_page_info[g_ram_pages_used];
+    uint8_t* ram = g_ram_pages[g_ram_pages_used++];
+    spi_flash_read(page_address, ram, SPI_FLASH_PAGE_SIZE);
+    info.address = page_address;
+    info.data = ram;
+    info.base_data = page.data;
+    info.base_length = page.data ? page.length : 0;
+    page.data = ram;
+    page.length = SPI_FLASH_PAGE_SIZE;
+    return ram;
+}
+
+bool spi_flash_write(uint32_t address, const uint8_t* data, uint32_t size) {
+    // Claim every RAM page first, so a write that cannot fit changes nothing.
+    for (uint32_t at = address; at < address + size; at += SPI_FLASH_PAGE_SIZE - at % SPI_FLASH_PAGE_SIZE) {
+        if (!spi_flash_page_for_write(at)) {
+            return false;
+        }
+    }
+    while (size > 0) {
+        uint8_t* ram = spi_flash_page_for_write(address);
+        if (!ram) {
+            return false;
+        }
+        uint32_t offset = address % SPI_FLASH_PAGE_SIZE;
+        uint32_t chunk = SPI_FLASH_PAGE_SIZE - offset;
+        if (chunk > size) {
+            chunk = size;
+        }
+        memcpy(ram + offset, data, chunk);
+        address += chunk;
+        data += chunk;
+        size -= chunk;
+    }
+    return true;
+}
+
+bool spi_flash_erase_sector(uint32_t address) {
+    uint8_t* ram = spi_flash_page_for_write(address);
+    if (!ram) {
+        return false;
+    }
+    memset(ram, 0xFF, SPI_FLASH_PAGE_SIZE);
+    return true;
+}
+
+uint8_t spi_flash_ram_page_count() {
+    return g_ram_pages_used;
+}
+
+void spi_flash_ram_page_info(uint8_t index, SpiFlashRamPage* out) {
+    *out = g_ram_page_info[index];
+}
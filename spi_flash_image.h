@@ -0,0 +1,61 @@
+/*
+ * Sparse emulation of the Pro Controller's 512 KB SPI flash. The address
+ * space is split into 4 KB pages; each page is erased (reads 0xFF), backed by
+ * constant data in Pico flash, or backed by a mutable copy in RAM.
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define SPI_FLASH_SIZE 0x80000u
+#define SPI_FLASH_PAGE_SIZE 0x1000u
+#define SPI_FLASH_PAGE_COUNT (SPI_FLASH_SIZE / SPI_FLASH_PAGE_SIZE)
+#define SPI_FLASH_RAM_PAGES 4
+
+// One constant page: bytes past length read back as 0xFF.
+typedef struct {
+    uint32_t address;  // page aligned
+    const uint8_t* data;
+    uint16_t length;   // <= SPI_FLASH_PAGE_SIZE
+} SpiFlashConstPage;
+
+// Reset every page to erased, then map the imported SPI image if the build has one.
+void spi_flash_image_init();
+
+// Map constant data at a page-aligned address (replaces any previous mapping).
+void spi_flash_map_const(uint32_t address, const uint8_t* data, uint16_t length);
+
+// True if the page containing address is backed by data (not erased).
+bool spi_flash_is_mapped(uint32_t address);
+
+// Copy [address, address + size) into dest; unmapped or out-of-range bytes are 0xFF.
+void spi_flash_read(uint32_t address, uint8_t* dest, uint32_t size);
+
+// Return the RAM copy of the page containing address, copying it out of its
+// constant backing on first use. Returns nullptr if the RAM page pool is full.
+uint8_t* spi_flash_page_for_write(uint32_t address);
+
+// Overwrite bytes (which may span pages). Returns false if a RAM page was
+// unavailable; bytes that did fit are still written.
+bool spi_flash_write(uint32_t address, const uint8_t* data, uint32_t size);
+
+// Erase the 4 KB sector containing address back to 0xFF.
+bool spi_flash_erase_sector(uint32_t address);
+
+// A page that has been copied to RAM, with the constant data it started from.
+typedef struct {
+    uint32_t address;
+    const uint8_t* data;       // current contents, SPI_FLASH_PAGE_SIZE bytes
+    const uint8_t* base_data;  // constant backing (nullptr: started erased)
+    uint16_t base_length;
+} SpiFlashRamPage;
+
+uint8_t spi_flash_ram_page_count();
+void spi_flash_ram_page_info(uint8_t index, SpiFlashRamPage* out);
+
+// Byte of the constant backing a RAM page started from (0xFF past its end).
+static inline uint8_t spi_flash_ram_page_base_byte(const SpiFlashRamPage& page, uint32_t offset) {
+    return page.base_data && offset < page.base_length ? page.base_data[offset] : 0xFF;
+}
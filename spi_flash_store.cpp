@@ -0,0 +1,512 @@
+#include "spi_flash_store.h"
+
+#include <stdio.h>
+#include <string.h>
+#include "hardware/flash.h"
+#include "flash_layout.h"
+#include "flash_ops.h"
+#include "spi_flash_image.h"
+
+#ifdef SWITCH_PICO_LOG
+#define LOG_PRINTF(...) printf(__VA_ARGS__)
+#else
+#define LOG_PRINTF(...) ((void)0)
+#endif
+
+/*
+ * Each store sector starts with a header naming its generation; the sector
+ * with the highest sequence is live. Records follow, word aligned:
+ *
+ *   type(1) length(1) checksum(1) reserved(1) address(4 LE) data[length]
+ *
+ * An erased type byte (0xFF) ends the log. A record with a bad checksum is a
+ * write torn by power loss: replay stops there and the sector is compacted.
+ * Compaction writes a snapshot of every modified page into the next sector
+ * and programs that sector's header last, so the old sector stays live until
+ * the new one is complete. Compaction only ever programs a sector erased ahead
+ * of time: at boot, or while USB is unmounted or suspended. While reports are
+ * flowing it runs one page program per pass, each right after a report goes
+ * out, and never erases.
+ */
+#define STORE_MAGIC 0x474C5053u  // "SPLG"
+#define STORE_HEADER_SIZE 16
+#define STORE_RECORD_HEADER_SIZE 8
+#define STORE_RECORD_WRITE 0x01
+#define STORE_RECORD_ERASE 0x02
+#define STORE_RECORD_MAX_DATA 0xF8
+
+#define STORE_PENDING_SIZE 512
+#define STORE_COMMIT_DELAY_US 100000     // batch writes the console sends back to back
+#define STORE_PROGRAM_BUDGET_US 4000     // worst-case page program plus core 1 lockout
+#define STORE_MIN_FREE_AT_BOOT 1024      // compact at boot if less log space remains
+#define STORE_RETRY_US 1000000           // wait after a failed erase or program before trying again
+
+typedef struct {
+    uint32_t magic;
+    uint32_t sequence;
+    uint32_t reserved[2];
+} StoreSectorHeader;
+
+static_assert(sizeof(StoreSectorHeader) == STORE_HEADER_SIZE, "store header size");
+
+static bool g_store_enabled = false;
+static uint8_t g_active_sector = 0;
+static uint32_t g_sequence = 0;
+static uint32_t g_write_offset = 0;  // next free byte in the active sector
+static bool g_needs_compaction = false;
+static bool g_snapshot_too_big = false;  // refuse new writes until the console erases something
+static uint8_t g_erased_sectors = 0;     // bit per sector known to be blank
+static bool g_usb_active = false;        // as last passed to spi_flash_store_task()
+
+// Compaction progress: snapshot, record pages, first page, header.
+typedef enum {
+    COMPACT_IDLE,
+    COMPACT_RECORDS,
+    COMPACT_FIRST_PAGE,
+    COMPACT_HEADER,
+} CompactStep;
+
+static CompactStep g_compact_step = COMPACT_IDLE;
+static uint8_t g_compact_sector = 0;   // erased sector the snapshot goes into
+static uint32_t g_compact_page = 0;    // next record page (COMPACT_RECORDS)
+static uint32_t g_compact_length = 0;  // bytes of the snapshot, header included
+static bool g_backoff = false;
+static absolute_time_t g_retry_time;
+
+// Records queued for the active sector, in log format.
+static uint8_t g_pending[STORE_PENDING_SIZE];
+static uint32_t g_pending_length = 0;
+static uint32_t g_pending_since_us = 0;
+
+// Sector-sized staging buffer for compaction snapshots.
+static uint8_t g_compact_buffer[FLASH_SECTOR_SIZE];
+
+static uint32_t sector_flash_offset(uint8_t sector) {
+    return SPI_STORE_FLASH_OFFSET + sector * FLASH_SECTOR_SIZE;
+}
+
+static const uint8_t* sector_data(uint8_t sector) {
+    return flash_ops_xip(sector_flash_offset(sector));
+}
+
+static uint32_t record_size(uint8_t length) {
+    return (STORE_RECORD_HEADER_SIZE + length + 3u) & ~3u;
+}
+
+static uint8_t record_checksum(uint8_t type, uint8_t length, uint32_t address, const uint8_t* data) {
+    uint8_t sum = type + length;
+    for (int i = 0; i < 4; ++i) {
+        sum += static_cast<uint8_t>(address >> (i * 8));
+    }
+    for (uint8_t i = 0; i < length; ++i) {
+        sum += data[i];
+    }
+    return static_cast<uint8_t>(~sum);
+}
+
+// Encode one record into dest (which must have record_size(length) bytes).
+static void encode_record(uint8_t* dest, uint8_t type, uint32_t address, const uint8_t* data, uint8_t length) {
+    memset(dest, 0xFF, record_size(length));
+    dest[0] = type;
+    dest[1] = length;
+    dest[2] = record_checksum(type, length, address, data);
+    dest[3] = 0xFF;
+    dest[4] = address & 0xFF;
+    dest[5] = (address >> 8) & 0xFF;
+    dest[6] = (address >> 16) & 0xFF;
+    dest[7] = (address >> 24) & 0xFF;
+    if (length) {
+        memcpy(dest + STORE_RECORD_HEADER_SIZE, data, length);
+    }
+}
+
+// Apply the records of a sector to the virtual SPI image. Returns the offset
+// just past the last good record, or the sector size if the log is torn.
+static uint32_t replay_sector(const uint8_t* sector) {
+    uint32_t offset = STORE_HEADER_SIZE;
+    while (offset + STORE_RECORD_HEADER_SIZE <= FLASH_SECTOR_SIZE) {
+        const uint8_t* record = sector + offset;
+        uint8_t type = record[0];
+        uint8_t length = record[1];
+        if (type == 0xFF) {
+            return offset;
+        }
+        uint32_t address = record[4] | (record[5] << 8) | (record[6] << 16) | (static_cast<uint32_t>(record[7]) << 24);
+        const uint8_t* data = record + STORE_RECORD_HEADER_SIZE;
+        if (offset + record_size(length) > FLASH_SECTOR_SIZE ||
+            record_checksum(type, length, address, data) != record[2]) {
+            LOG_PRINTF("[SPI] store: torn record at 0x%03lx, compacting\n", (unsigned long)offset);
+            g_needs_compaction = true;
+            return FLASH_SECTOR_SIZE;
+        }
+        if (type == STORE_RECORD_WRITE) {
+            spi_flash_write(address, data, length);
+        } else if (type == STORE_RECORD_ERASE) {
+            spi_flash_erase_sector(address);
+        }
+        offset += record_size(length);
+    }
+    return offset;
+}
+
+static bool append_snapshot_record(uint32_t* offset, uint8_t type, uint32_t address, const uint8_t* data, uint8_t length) {
+    if (*offset + record_size(length) > FLASH_SECTOR_SIZE) {
+        return false;
+    }
+    encode_record(g_compact_buffer + *offset, type, address, data, length);
+    *offset += record_size(length);
+    return true;
+}
+
+// Records that rebuild one RAM page from its constant backing. Either patch the
+// bytes that differ, or erase and rewrite the non-0xFF bytes, whichever is smaller.
+static bool snapshot_page(uint32_t* offset, const SpiFlashRamPage& page) {
+    uint32_t diff_bytes = 0;
+    uint32_t written_bytes = 0;
+    for (uint32_t i = 0; i < SPI_FLASH_PAGE_SIZE; ++i) {
+        diff_bytes += page.data[i] != spi_flash_ram_page_base_byte(page, i);
+        written_bytes += page.data[i] != 0xFF;
+    }
+    if (diff_bytes == 0) {
+        return true;
+    }
+    bool from_erased = written_bytes < diff_bytes;
+    if (from_erased && !append_snapshot_record(offset, STORE_RECORD_ERASE, page.address, nullptr, 0)) {
+        return false;
+    }
+
+    uint32_t i = 0;
+    while (i < SPI_FLASH_PAGE_SIZE) {
+        uint8_t reference = from_erased ? 0xFF : spi_flash_ram_page_base_byte(page, i);
+        if (page.data[i] == reference) {
+            ++i;
+            continue;
+        }
+        uint32_t start = i;
+        while (i < SPI_FLASH_PAGE_SIZE && i - start < STORE_RECORD_MAX_DATA &&
+               page.data[i] != (from_erased ? 0xFF : spi_flash_ram_page_base_byte(page, i))) {
+            ++i;
+        }
+        if (!append_snapshot_record(offset, STORE_RECORD_WRITE, page.address + start, page.data + start,
+                                    static_cast<uint8_t>(i - start))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Stage the current state of every modified page in g_compact_buffer. Records
+// queued so far are part of it; later ones stay queued for the new sector.
+static bool build_snapshot() {
+    memset(g_compact_buffer, 0xFF, sizeof(g_compact_buffer));
+    uint32_t offset = STORE_HEADER_SIZE;
+    for (uint8_t i = 0; i < spi_flash_ram_page_count(); ++i) {
+        SpiFlashRamPage page;
+        spi_flash_ram_page_info(i, &page);
+        if (!snapshot_page(&offset, page)) {
+            // Keep the log as it is and turn new writes away until an erase shrinks the image.
+            LOG_PRINTF("[SPI] store: snapshot does not fit one sector; refusing writes\n");
+            g_snapshot_too_big = true;
+            return false;
+        }
+    }
+    g_compact_length = offset;
+    g_pending_length = 0;
+    g_needs_compaction = false;
+    return true;
+}
+
+static bool sector_blank(uint8_t sector) {
+    const uint32_t* words = reinterpret_cast<const uint32_t*>(sector_data(sector));
+    for (uint32_t i = 0; i < FLASH_SECTOR_SIZE / 4; ++i) {
+        if (words[i] != 0xFFFFFFFFu) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Erased sector to compact into, nearest after the active one (rotating
+// spreads wear); -1 if there is none yet.
+static int erased_target() {
+    for (uint8_t step = 1; step < SPI_STORE_SECTOR_COUNT; ++step) {
+        uint8_t sector = static_cast<uint8_t>((g_active_sector + step) % SPI_STORE_SECTOR_COUNT);
+        if (g_erased_sectors & (1u << sector)) {
+            return sector;
+        }
+    }
+    return -1;
+}
+
+// Sector other than the active one that still needs erasing; -1 if none.
+static int unerased_spare() {
+    for (uint8_t step = 1; step < SPI_STORE_SECTOR_COUNT; ++step) {
+        uint8_t sector = static_cast<uint8_t>((g_active_sector + step) % SPI_STORE_SECTOR_COUNT);
+        if (!(g_erased_sectors & (1u << sector))) {
+            return sector;
+        }
+    }
+    return -1;
+}
+
+// Wait a while after a failed erase or program rather than retrying on every pass.
+static void back_off() {
+    g_backoff = true;
+    g_retry_time = make_timeout_time_us(STORE_RETRY_US);
+}
+
+// Erase one retired sector ahead of the compaction that will need it. Only
+// where a stall does not matter: at boot or while USB is idle.
+static void erase_spare() {
+    int sector = unerased_spare();
+    if (sector < 0) {
+        return;
+    }
+    if (!flash_ops_erase_sector(sector_flash_offset(static_cast<uint8_t>(sector)))) {
+        LOG_PRINTF("[SPI] store: erasing sector %d failed, retrying later\n", sector);
+        back_off();
+        return;
+    }
+    g_erased_sectors = static_cast<uint8_t>(g_erased_sectors | (1u << sector));
+}
+
+// The target is no longer blank; rebuild the snapshot into another erased
+// sector once one is available.
+static void compact_failed() {
+    LOG_PRINTF("[SPI] store: compaction failed, retrying later\n");
+    g_compact_step = COMPACT_IDLE;
+    g_needs_compaction = true;
+    back_off();
+}
+
+// Advance compaction by at most one page program. Needs an erased sector.
+static void compact_step() {
+    uint32_t sector_offset = sector_flash_offset(g_compact_sector);
+    uint8_t page[FLASH_PAGE_SIZE];
+    switch (g_compact_step) {
+        case COMPACT_IDLE: {
+            int target = erased_target();
+            if (target < 0 || !build_snapshot()) {
+                return;
+            }
+            g_compact_sector = static_cast<uint8_t>(target);
+            g_erased_sectors = static_cast<uint8_t>(g_erased_sectors & ~(1u << target));
+            g_compact_page = 1;
+            g_compact_step = COMPACT_RECORDS;
+            return;
+        }
+        case COMPACT_RECORDS: {
+            // Records first; pages past the snapshot stay erased.
+            uint32_t used_pages = (g_compact_length + FLASH_PAGE_SIZE - 1) / FLASH_PAGE_SIZE;
+            if (g_compact_page >= used_pages) {
+                g_compact_step = COMPACT_FIRST_PAGE;
+                return;
+            }
+            if (!flash_ops_program(sector_offset + g_compact_page * FLASH_PAGE_SIZE,
+                                   g_compact_buffer + g_compact_page * FLASH_PAGE_SIZE, FLASH_PAGE_SIZE)) {
+                compact_failed();
+                return;
+            }
+            g_compact_page++;
+            return;
+        }
+        case COMPACT_FIRST_PAGE:
+            memcpy(page, g_compact_buffer, FLASH_PAGE_SIZE);
+            memset(page, 0xFF, STORE_HEADER_SIZE);
+            if (!flash_ops_program(sector_offset, page, FLASH_PAGE_SIZE)) {
+                compact_failed();
+                return;
+            }
+            g_compact_step = COMPACT_HEADER;
+            return;
+        case COMPACT_HEADER: {
+            // Header last: until it lands, the old sector stays live.
+            StoreSectorHeader header{STORE_MAGIC, g_sequence + 1, {0xFFFFFFFFu, 0xFFFFFFFFu}};
+            memset(page, 0xFF, sizeof(page));
+            memcpy(page, &header, sizeof(header));
+            if (!flash_ops_program(sector_offset, page, FLASH_PAGE_SIZE)) {
+                compact_failed();
+                return;
+            }
+            g_active_sector = g_compact_sector;
+            g_sequence++;
+            g_write_offset = g_compact_length;
+            g_compact_step = COMPACT_IDLE;
+            g_backoff = false;
+            LOG_PRINTF("[SPI] store: compacted into sector %u (%lu bytes used)\n", g_active_sector,
+                       (unsigned long)g_compact_length);
+            return;
+        }
+    }
+}
+
+static bool compaction_active() {
+    return g_compact_step != COMPACT_IDLE || (g_needs_compaction && !g_snapshot_too_big);
+}
+
+// Boot: nothing is timing-critical yet, so run every step back to back.
+static void compact_now() {
+    g_backoff = false;
+    compact_step();
+    while (g_compact_step != COMPACT_IDLE && !g_backoff) {
+        compact_step();
+    }
+}
+
+// Boot: erase every retired sector, so compaction while USB is busy has
+// somewhere to go without erasing.
+static void erase_spares_now() {
+    for (uint8_t sector = 0; sector < SPI_STORE_SECTOR_COUNT; ++sector) {
+        if (sector != g_active_sector && sector_blank(sector)) {
+            g_erased_sectors = static_cast<uint8_t>(g_erased_sectors | (1u << sector));
+        }
+    }
+    g_backoff = false;
+    while (unerased_spare() >= 0 && !g_backoff) {
+        erase_spare();
+    }
+}
+
+void spi_flash_store_init() {
+    if (!flash_ops_persistent_area_free()) {
+        LOG_PRINTF("[SPI] store: program image overlaps the store; SPI writes will not persist\n");
+        return;
+    }
+
+    bool found = false;
+    for (uint8_t i = 0; i < SPI_STORE_SECTOR_COUNT; ++i) {
+        StoreSectorHeader header;
+        memcpy(&header, sector_data(i), sizeof(header));
+        if (header.magic != STORE_MAGIC) {
+            continue;
+        }
+        if (!found || static_cast<int32_t>(header.sequence - g_sequence) > 0) {
+            found = true;
+            g_active_sector = i;
+            g_sequence = header.sequence;
+        }
+    }
+
+    g_store_enabled = true;
+    if (found) {
+        g_write_offset = replay_sector(sector_data(g_active_sector));
+    } else {
+        g_active_sector = SPI_STORE_SECTOR_COUNT - 1;  // first compaction lands in sector 0
+        g_needs_compaction = true;
+    }
+    erase_spares_now();
+    if (g_needs_compaction || FLASH_SECTOR_SIZE - g_write_offset < STORE_MIN_FREE_AT_BOOT) {
+        g_needs_compaction = true;
+        compact_now();
+        erase_spares_now();  // the sector compaction retired
+    }
+    g_backoff = false;
+}
+
+static bool queue_record(uint8_t type, uint32_t address, const uint8_t* data, uint8_t length) {
+    if (!g_store_enabled) {
+        return false;
+    }
+    if (g_pending_length == 0) {
+        g_pending_since_us = time_us_32();
+    }
+    if (g_pending_length + record_size(length) > STORE_PENDING_SIZE) {
+        g_needs_compaction = true;  // the RAM image holds it; the next snapshot (mounted or not) persists it
+        return true;
+    }
+    encode_record(g_pending + g_pending_length, type, address, data, length);
+    g_pending_length += record_size(length);
+    return true;
+}
+
+bool spi_flash_store_write(uint32_t address, const uint8_t* data, uint8_t size) {
+    if (size > STORE_RECORD_MAX_DATA || g_snapshot_too_big || !spi_flash_write(address, data, size)) {
+        return false;
+    }
+    queue_record(STORE_RECORD_WRITE, address, data, size);
+    return true;
+}
+
+bool spi_flash_store_erase(uint32_t address) {
+    address -= address % SPI_FLASH_PAGE_SIZE;
+    if (!spi_flash_erase_sector(address)) {
+        return false;
+    }
+    g_snapshot_too_big = false;  // the image shrank; try compacting again
+    queue_record(STORE_RECORD_ERASE, address, nullptr, 0);
+    return true;
+}
+
+void spi_flash_store_task(absolute_time_t report_deadline, bool usb_active) {
+    if (!g_store_enabled) {
+        return;
+    }
+    g_usb_active = usb_active;
+    if (g_backoff) {
+        if (absolute_time_diff_us(get_absolute_time(), g_retry_time) > 0) {
+            return;
+        }
+        g_backoff = false;
+    }
+    if (!usb_active && unerased_spare() >= 0) {
+        erase_spare();  // nobody is waiting on reports
+        return;
+    }
+    if (compaction_active()) {
+        // Queued records wait for the new sector; the old one is about to retire.
+        if (g_compact_step == COMPACT_IDLE && erased_target() < 0) {
+            return;  // every spare used this session; the RAM image keeps the data until USB goes idle
+        }
+        if (usb_active && absolute_time_diff_us(get_absolute_time(), report_deadline) < STORE_PROGRAM_BUDGET_US) {
+            return;  // one step right after the next report goes out
+        }
+        compact_step();
+        return;
+    }
+    if (g_pending_length == 0 || time_us_32() - g_pending_since_us < STORE_COMMIT_DELAY_US) {
+        return;
+    }
+    if (absolute_time_diff_us(get_absolute_time(), report_deadline) < STORE_PROGRAM_BUDGET_US) {
+        return;  // retry right after the next report goes out
+    }
+    if (g_write_offset + g_pending_length > FLASH_SECTOR_SIZE) {
+        g_needs_compaction = true;
+        return;
+    }
+
+    // Program the flash page holding the log tail. Bytes outside the new
+    // records are 0xFF, which leaves already-programmed bytes untouched.
+    uint32_t page_start = g_write_offset & ~(FLASH_PAGE_SIZE - 1u);
+    uint32_t chunk = page_start + FLASH_PAGE_SIZE - g_write_offset;
+    if (chunk > g_pending_length) {
+        chunk = g_pending_length;
+    }
+    uint8_t page[FLASH_PAGE_SIZE];
+    memset(page, 0xFF, sizeof(page));
+    memcpy(page + (g_write_offset - page_start), g_pending, chunk);
+    if (!flash_ops_program(sector_flash_offset(g_active_sector) + page_start, page, FLASH_PAGE_SIZE)) {
+        return;
+    }
+    g_write_offset += chunk;
+    g_pending_length -= chunk;
+    memmove(g_pending, g_pending + chunk, g_pending_length);
+}
+
+absolute_time_t spi_flash_store_next_task_time() {
+    if (!g_store_enabled) {
+        return at_the_end_of_time;
+    }
+    bool erase_due = !g_usb_active && unerased_spare() >= 0;
+    bool compaction_due = compaction_active() && (g_compact_step != COMPACT_IDLE || erased_target() >= 0);
+    if (erase_due || compaction_due) {
+        return g_backoff ? g_retry_time : get_absolute_time();
+    }
+    if (compaction_active()) {
+        return at_the_end_of_time;  // waiting for an erased sector; USB going idle wakes the loop
+    }
+    if (g_pending_length == 0) {
+        return at_the_end_of_time;
+    }
+    uint32_t waited = time_us_32() - g_pending_since_us;
+    return make_timeout_time_us(waited >= STORE_COMMIT_DELAY_US ? 0 : STORE_COMMIT_DELAY_US - waited);
+}
@@ -0,0 +1,34 @@
+/*
+ * Persistence for console writes to the emulated SPI flash. Writes and erases
+ * update the virtual SPI image immediately and are appended to a log in the
+ * Pico's flash later, between reports. When the log sector fills, compaction
+ * moves a snapshot into a sector erased ahead of time, one page program per
+ * report gap. Sectors are only erased at boot or while USB is idle, so flash
+ * work never holds back a report.
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "pico/time.h"
+
+// Replay the persisted log into the virtual SPI image, compacting it if it is
+// nearly full. Call on core 0 after the constant SPI pages are mapped and
+// before core 1 is launched.
+void spi_flash_store_init();
+
+// Apply a console SPI_WRITE / SPI_ERASE and queue it for flash. A write is
+// refused, leaving the image untouched, if it does not fit the RAM pages or if
+// the modified pages no longer fit one log sector (until an erase frees room).
+bool spi_flash_store_write(uint32_t address, const uint8_t* data, uint8_t size);
+bool spi_flash_store_erase(uint32_t address);
+
+// Commit queued records or advance compaction when safe: one flash operation
+// per call. usb_active means mounted and not suspended: then only page
+// programs run, and only when report_deadline leaves room; retired sectors
+// are erased once it is false.
+void spi_flash_store_task(absolute_time_t report_deadline, bool usb_active);
+
+// When spi_flash_store_task() next has work (at_the_end_of_time if none).
+absolute_time_t spi_flash_store_next_task_time();
@@ -0,0 +1,50 @@
+/*
+ * Fixed-size single-producer single-consumer queue for handing items between
+ * cores without locks. Unlike SeqlockSnapshot nothing is overwritten: push()
+ * fails when the queue is full, so use it for messages that must not be lost.
+ *
+ * Exactly one context may push and exactly one may pop.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include "hardware/sync.h"
+
+template <typename T, uint32_t N>
+class SpscQueue {
+    static_assert(N && (N & (N - 1)) == 0, "SpscQueue size must be a power of two");
+
+public:
+    constexpr SpscQueue() : head_(0), tail_(0), items_{} {}
+
+    bool push(const T& item) {
+        uint32_t head = head_;
+        if (head - tail_ >= N) {
+            return false;
+        }
+        items_[head & (N - 1)] = item;
+        __dmb();
+        head_ = head + 1;
+        return true;
+    }
+
+    bool pop(T* out) {
+        uint32_t tail = tail_;
+        if (head_ == tail) {
+            return false;
+        }
+        __dmb();
+        *out = items_[tail & (N - 1)];
+        __dmb();
+        tail_ = tail + 1;
+        return true;
+    }
+
+    bool empty() const { return head_ == tail_; }
+
+private:
+    volatile uint32_t head_;  // written by the producer only
+    volatile uint32_t tail_;  // written by the consumer only
+    T items_[N];
+};
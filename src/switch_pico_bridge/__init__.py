@@ -6,25 +6,45 @@ Expose the UART helpers at the package root so callers can import
 """
 
 from .switch_pico_uart import (  # noqa: F401
+    ControllerIdentity,
+    MacroBuilder,
+    MacroSlot,
+    RecordedRun,
+    SocdMode,
+    StickCalibrationStatus,
+    StickMergePolicy,
+    StickShape,
     SwitchButton,
     SwitchDpad,
     SwitchUARTClient,
     axis_to_stick,
     decode_rumble,
+    decode_rumble_frequencies,
     discover_serial_ports,
     first_serial_port,
+    raw_dpad,
     str_to_dpad,
     trigger_to_button,
 )
 
 __all__ = [
     "SwitchUARTClient",
+    "ControllerIdentity",
+    "MacroBuilder",
+    "MacroSlot",
+    "RecordedRun",
+    "SocdMode",
+    "StickCalibrationStatus",
+    "StickMergePolicy",
+    "StickShape",
     "SwitchButton",
     "SwitchDpad",
     "discover_serial_ports",
     "first_serial_port",
+    "raw_dpad",
     "axis_to_stick",
     "decode_rumble",
+    "decode_rumble_frequencies",
     "str_to_dpad",
     "trigger_to_button",
 ]
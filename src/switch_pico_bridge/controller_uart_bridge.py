@@ -4,7 +4,7 @@ Bridge multiple SDL2 controllers to switch-pico over UART and mirror rumble back
 
 The framing matches ``switch-pico.cpp``:
   - Host -> Pico : 0xAA, buttons (LE16), hat, lx, ly, rx, ry
-  - Pico -> Host : 0xBB, 0x01, 8 rumble bytes, checksum (sum of first 10 bytes)
+  - Pico -> Host : 0xBB, type, rumble payload, checksum (see ``switch_pico_uart``)
 
 Features inspired by ``host/controller_bridge.py``:
   - Multiple controllers paired to multiple UART ports
@@ -43,6 +43,7 @@ from .switch_pico_uart import (
     IMU_SAMPLES_PER_REPORT,
     IMUSample,
     PicoUART,
+    RumbleLatencyTracker,
     SwitchButton,
     SwitchDpad,
     SwitchReport,
@@ -55,8 +56,9 @@ from .switch_pico_uart import (
 
 RUMBLE_IDLE_TIMEOUT = 0.25  # seconds without packets before forcing rumble off
 RUMBLE_STUCK_TIMEOUT = 0.60  # continuous same-energy rumble will be stopped after this
-RUMBLE_MIN_ACTIVE = 0.40  # below this, rumble is treated as off/noise
+RUMBLE_MIN_ACTIVE = 0.10  # below this (decoded amplitude), rumble is treated as off/noise
 RUMBLE_SCALE = 1.0
+RUMBLE_LATENCY_REPORT_INTERVAL = 10.0  # seconds between --rumble-latency histograms
 CONTROLLER_DB_URL_DEFAULT = "https://raw.githubusercontent.com/mdqinc/SDL_GameControllerDB/refs/heads/master/gamecontrollerdb.txt"
 SDL_TRUE = True
 SDL_EVENT_GAMEPAD_SENSOR_UPDATE = getattr(sdl3, "SDL_EVENT_GAMEPAD_SENSOR_UPDATE", 0x658)
@@ -202,6 +204,7 @@ def interactive_pairing(
 
 def apply_rumble(controller: sdl3.SDL_Gamepad, payload: bytes) -> float:
     """Apply rumble payload to SDL controller and return max normalized energy."""
+    # Low band drives the low-frequency motor, high band the high-frequency one.
     left_norm, right_norm = decode_rumble(payload)
     max_norm = max(left_norm, right_norm)
     # Treat small rumble as "off" to avoid idle buzz.
@@ -212,7 +215,9 @@ def apply_rumble(controller: sdl3.SDL_Gamepad, payload: bytes) -> float:
     scale = RUMBLE_SCALE
     low = int(min(1.0, left_norm * scale) * 0xFFFF)  # SDL: low_frequency_rumble
     high = int(min(1.0, right_norm * scale) * 0xFFFF)  # SDL: high_frequency_rumble
-    duration = 10
+    # The firmware only forwards changed payloads (refreshing active rumble every
+    # ~100 ms), so hold the effect until the idle timeout stops it explicitly.
+    duration = int(RUMBLE_IDLE_TIMEOUT * 1000)
     sdl3.SDL_RumbleGamepad(controller, low, high, duration)
     return max_norm
 
@@ -244,6 +249,8 @@ class ControllerContext:
     last_rumble_change: float = 0.0
     last_rumble_energy: float = 0.0
     rumble_active: bool = False
+    rumble_latency: RumbleLatencyTracker = field(default_factory=RumbleLatencyTracker)
+    last_latency_report: float = 0.0
     axis_offsets: Dict[int, int] = field(default_factory=dict)
     swap_abxy: bool = False
     sensors_supported: bool = False
@@ -773,6 +780,11 @@ def build_arg_parser() -> argparse.ArgumentParser:
         default=1.0,
         help="Scale factor for gyro sensitivity (default 1.0). Reduce below 1.0 if camera moves too fast.",
     )
+    parser.add_argument(
+        "--rumble-latency",
+        action="store_true",
+        help="Log a histogram of Switch-to-motor rumble latency every 10 seconds.",
+    )
     return parser
 
 
@@ -821,6 +833,7 @@ class BridgeConfig:
     debug_imu: bool = False
     no_imu: bool = False
     gyro_scale: float = 1.0
+    rumble_latency: bool = False
 
 
 class DisplayIndexAllocator:
@@ -913,6 +926,7 @@ def build_bridge_config(console: Console, args: argparse.Namespace) -> BridgeCon
         debug_imu=bool(args.debug_imu),
         no_imu=bool(args.no_imu),
         gyro_scale=float(args.gyro_scale),
+        rumble_latency=bool(args.rumble_latency),
     )
 
 
@@ -1579,15 +1593,22 @@ def service_contexts(
                 ctx.last_send = now
 
             last_payload = None
+            last_arrival = None
             while True:
                 p = ctx.uart.read_rumble_payload()
                 if not p:
                     break
                 last_payload = p
+                if config.rumble_latency:
+                    last_arrival = ctx.rumble_latency.observe_frame(
+                        p, time.perf_counter()
+                    )
 
             if last_payload is not None:
                 # Apply only the freshest rumble payload seen during this tick.
                 energy = apply_rumble(ctx.controller, last_payload)
+                if last_arrival is not None:
+                    ctx.rumble_latency.record_applied(last_arrival, time.perf_counter())
                 ctx.rumble_active = energy >= RUMBLE_MIN_ACTIVE
                 if ctx.rumble_active and energy != ctx.last_rumble_energy:
                     ctx.last_rumble_change = now
@@ -1604,6 +1625,13 @@ def service_contexts(
                 sdl3.SDL_RumbleGamepad(ctx.controller, 0, 0, 0)
                 ctx.rumble_active = False
                 ctx.last_rumble_energy = 0.0
+            if (
+                config.rumble_latency
+                and (now - ctx.last_latency_report) >= RUMBLE_LATENCY_REPORT_INTERVAL
+            ):
+                ctx.last_latency_report = now
+                for line in ctx.rumble_latency.format_histogram():
+                    console.print(f"[cyan]Controller {ctx.controller_index} {line}[/cyan]")
         except SerialException as exc:
             console.print(f"[yellow]UART {ctx.port} disconnected: {exc}[/yellow]")
             try:
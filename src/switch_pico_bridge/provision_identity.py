@@ -0,0 +1,126 @@
+#!/usr/bin/env python3
+"""
+Show or change the identity (MAC, serial, colours, controller type) stored on
+a switch-pico over its UART link.
+
+Unspecified fields keep the Pico's current values, so provisioning a unit only
+needs the fields that differ. The Pico stores the record and reboots into it.
+"""
+
+import argparse
+import sys
+from dataclasses import replace
+from typing import Optional
+
+from .switch_pico_uart import (
+    CONTROLLER_TYPE_LEFT_JOYCON,
+    CONTROLLER_TYPE_PRO,
+    CONTROLLER_TYPE_RIGHT_JOYCON,
+    IDENTITY_STATUS_PENDING,
+    IDENTITY_STATUS_REJECTED,
+    UART_BAUD,
+    ControllerIdentity,
+    SwitchUARTClient,
+    format_mac,
+    parse_color,
+    parse_mac,
+    random_mac,
+)
+
+CONTROLLER_TYPES = {
+    "pro": CONTROLLER_TYPE_PRO,
+    "left-joycon": CONTROLLER_TYPE_LEFT_JOYCON,
+    "right-joycon": CONTROLLER_TYPE_RIGHT_JOYCON,
+}
+STATUS_NAMES = {0: "active", IDENTITY_STATUS_PENDING: "stored, rebooting", IDENTITY_STATUS_REJECTED: "rejected"}
+
+
+def describe(identity: ControllerIdentity) -> str:
+    type_name = next((k for k, v in CONTROLLER_TYPES.items() if v == identity.controller_type), None)
+
+    def hex_color(color) -> str:
+        return "".join(f"{c:02X}" for c in color)
+
+    return "\n".join(
+        [
+            f"  MAC         {format_mac(identity.mac)}",
+            f"  type        {type_name or hex(identity.controller_type)}",
+            f"  serial      {identity.serial or '(none)'}",
+            f"  body        {hex_color(identity.body_color)}",
+            f"  buttons     {hex_color(identity.button_color)}",
+            f"  left grip   {hex_color(identity.left_grip_color)}",
+            f"  right grip  {hex_color(identity.right_grip_color)}",
+        ]
+    )
+
+
+def apply_arguments(identity: ControllerIdentity, args: argparse.Namespace) -> ControllerIdentity:
+    """Return identity with every field given on the command line replaced."""
+    changes = {}
+    if args.mac:
+        changes["mac"] = random_mac() if args.mac == "random" else parse_mac(args.mac)
+    if args.type:
+        changes["controller_type"] = CONTROLLER_TYPES[args.type]
+    if args.serial is not None:
+        changes["serial"] = args.serial
+    for name in ("body", "buttons", "left_grip", "right_grip"):
+        value = getattr(args, name)
+        if value:
+            field_name = "button_color" if name == "buttons" else f"{name}_color"
+            changes[field_name] = parse_color(value)
+    if args.grip:
+        changes["left_grip_color"] = changes["right_grip_color"] = parse_color(args.grip)
+    return replace(identity, **changes)
+
+
+def main(argv: Optional[list] = None) -> int:
+    parser = argparse.ArgumentParser(description=__doc__.strip().splitlines()[0])
+    parser.add_argument("-p", "--port", required=True, help="Serial port of the Pico's UART1 link")
+    parser.add_argument("-b", "--baud", type=int, default=UART_BAUD, help=f"Baud rate (default: {UART_BAUD})")
+    parser.add_argument("--mac", help="aa:bb:cc:dd:ee:ff, or 'random' for a new address")
+    parser.add_argument("--type", choices=sorted(CONTROLLER_TYPES), help="Controller type reported to the console")
+    parser.add_argument("--serial", help="Serial number (up to 16 ASCII characters, '' to clear)")
+    parser.add_argument("--body", help="Body colour RRGGBB")
+    parser.add_argument("--buttons", help="Button colour RRGGBB")
+    parser.add_argument("--left-grip", help="Left grip colour RRGGBB")
+    parser.add_argument("--right-grip", help="Right grip colour RRGGBB")
+    parser.add_argument("--grip", help="Both grip colours RRGGBB")
+    parser.add_argument("--timeout", type=float, default=1.0, help="Seconds to wait for each reply")
+    args = parser.parse_args(argv)
+
+    client = SwitchUARTClient(args.port, args.baud, auto_send=False)
+    try:
+        current = client.read_identity(args.timeout)
+        if current is None:
+            print("error: no identity reply from the Pico (check wiring and firmware version)", file=sys.stderr)
+            return 1
+        status, identity = current
+        print(f"Current identity ({STATUS_NAMES.get(status, status)}):")
+        print(describe(identity))
+
+        try:
+            updated = apply_arguments(identity, args)
+            updated.to_bytes()  # validate before sending
+        except ValueError as exc:
+            print(f"error: {exc}", file=sys.stderr)
+            return 1
+        if updated == identity:
+            return 0
+
+        reply = client.write_identity(updated, args.timeout)
+        if reply is None:
+            print("error: no reply to the identity update", file=sys.stderr)
+            return 1
+        status, stored = reply
+        if status == IDENTITY_STATUS_REJECTED:
+            print("error: the Pico rejected the identity", file=sys.stderr)
+            return 1
+        print(f"New identity ({STATUS_NAMES.get(status, status)}):")
+        print(describe(stored))
+        return 0
+    finally:
+        client.close()
+
+
+if __name__ == "__main__":
+    sys.exit(main())
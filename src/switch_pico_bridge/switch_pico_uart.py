@@ -6,16 +6,45 @@ This module exposes the raw report structure plus a small convenience wrapper
 so other scripts can do things like "press a button" or "move a stick" without
 depending on SDL. It mirrors the framing in ``switch-pico.cpp``:
 
-  Host -> Pico : 0xAA, buttons (LE16), hat, lx, ly, rx, ry
-  Pico -> Host : 0xBB, 0x01, 8 rumble bytes, checksum (sum of first 10 bytes)
+  Host -> Pico : 0xAA, type, payload length, payload, checksum
+      type 0x02: buttons (LE16), hat, lx, ly, rx, ry, IMU count, IMU samples
+                 (hat bit 7 set: raw dpad directions in bits 0-3, see ``raw_dpad``)
+      type 0x10: controller identity to store (see ``ControllerIdentity``)
+      type 0x11: request the stored identity (empty payload)
+      type 0x20: macro upload: offset (LE16) + bytecode (see ``MacroBuilder``)
+      type 0x21: macro control: stop (0x00), run (0x01 + length LE16), status (0x02),
+                 play slot (0x03), save slot (0x04), delete slot (0x05), list (0x06)
+      type 0x30: input recorder: stop, record, replay, status, read runs, write runs
+      type 0x40: turbo: buttons (LE16), reports on, reports off (on = 0 disables)
+      type 0x41: stick shaping: sticks, deadzone, anti-deadzone, saturation, expo (percent), flags
+      type 0x42: SOCD mode (see ``SocdMode``)
+      type 0x43: stick merge policy (see ``StickMergePolicy``)
+      type 0x44: stick calibration learning: stop, learn, save, clear, status
+  Pico -> Host : 0xBB, type, payload, checksum (sum of all preceding bytes)
+      type 0x01: 8 raw HD rumble bytes (older firmware)
+      type 0x02: low amp, low freq, high amp, high freq (decoded on the Pico)
+      type 0x03: type 0x02 payload + USB arrival time (LE32 us) + dwell (LE16 us)
+      type 0x10: identity status byte + ``ControllerIdentity`` record
+      type 0x20: macro reply: result, state, program counter (LE16), playing slot
+      type 0x21: saved macro: slot, length (LE16), chord (LE16), name (16 bytes)
+      type 0x30: recorder reply: result, state, runs (LE16), position (LE16), reports (LE32)
+      type 0x31: recorded runs: index (LE16), count, three 16-byte ``RecordedRun`` records
+      type 0x40: turbo reply: accepted, turbo-enabled buttons (LE16)
+      type 0x41: stick shaping reply: accepted
+      type 0x42: SOCD reply: accepted, current mode
+      type 0x43: merge reply: accepted, current stick policy, active input slots
+      type 0x44: stick calibration reply: result, learning, sticks saved, observed ranges (LE16)
 """
 
 from __future__ import annotations
 
 import math
+import os
 import struct
 import time
 import threading
+from collections import deque
+from contextlib import contextmanager
 from dataclasses import dataclass, field
 from enum import IntEnum, IntFlag
 from typing import Iterable, Mapping, Optional, Tuple, Union, List, Dict
@@ -25,8 +54,88 @@ from serial.tools import list_ports, list_ports_common
 
 UART_HEADER = 0xAA
 UART_PROTOCOL_VERSION = 0x02
+UART_FRAME_INPUT = UART_PROTOCOL_VERSION
+UART_FRAME_IDENTITY_SET = 0x10
+UART_FRAME_IDENTITY_GET = 0x11
+UART_FRAME_MACRO_UPLOAD = 0x20
+UART_FRAME_MACRO_CONTROL = 0x21
+UART_FRAME_RECORDER = 0x30
+UART_FRAME_TURBO = 0x40
+UART_FRAME_STICK_SHAPE = 0x41
+UART_FRAME_SOCD = 0x42
+UART_FRAME_MERGE = 0x43
+UART_FRAME_STICK_CALIBRATION = 0x44
+UART_FRAME_MAX_PAYLOAD = 60
 RUMBLE_HEADER = 0xBB
 RUMBLE_TYPE_RUMBLE = 0x01
+RUMBLE_TYPE_COMPACT = 0x02
+RUMBLE_TYPE_TIMED = 0x03
+RUMBLE_PAYLOAD_LENGTHS = {
+    RUMBLE_TYPE_RUMBLE: 8,
+    RUMBLE_TYPE_COMPACT: 4,
+    RUMBLE_TYPE_TIMED: 10,
+}
+PICO_REPLY_IDENTITY = 0x10
+IDENTITY_RECORD_LENGTH = 35
+PICO_REPLY_MACRO = 0x20
+PICO_REPLY_MACRO_SLOT = 0x21
+PICO_REPLY_RECORDER = 0x30
+PICO_REPLY_RECORDER_RUNS = 0x31
+PICO_REPLY_TURBO = 0x40
+PICO_REPLY_STICK_SHAPE = 0x41
+PICO_REPLY_SOCD = 0x42
+PICO_REPLY_MERGE = 0x43
+PICO_REPLY_STICK_CALIBRATION = 0x44
+MACRO_NAME_LENGTH = 16
+RECORDED_RUN_LENGTH = 16
+RECORDER_RUNS_PER_FRAME = 3
+PICO_FRAME_PAYLOAD_LENGTHS = {
+    **RUMBLE_PAYLOAD_LENGTHS,
+    PICO_REPLY_IDENTITY: 1 + IDENTITY_RECORD_LENGTH,
+    PICO_REPLY_MACRO: 5,
+    PICO_REPLY_MACRO_SLOT: 5 + MACRO_NAME_LENGTH,
+    PICO_REPLY_RECORDER: 10,
+    PICO_REPLY_RECORDER_RUNS: 3 + RECORDER_RUNS_PER_FRAME * RECORDED_RUN_LENGTH,
+    PICO_REPLY_TURBO: 3,
+    PICO_REPLY_STICK_SHAPE: 1,
+    PICO_REPLY_SOCD: 2,
+    PICO_REPLY_MERGE: 3,
+    PICO_REPLY_STICK_CALIBRATION: 3 + 2 * 6 * 2,
+}
+IDENTITY_STATUS_ACTIVE = 0
+IDENTITY_STATUS_PENDING = 1  # stored; the Pico reboots into it moments later
+IDENTITY_STATUS_REJECTED = 2
+CONTROLLER_TYPE_LEFT_JOYCON = 0x01
+CONTROLLER_TYPE_RIGHT_JOYCON = 0x02
+CONTROLLER_TYPE_PRO = 0x03
+DEFAULT_MAC_PREFIX = bytes([0x7C, 0xBB, 0x8A])
+MACRO_SLOT_SIZE = 1024
+MACRO_CONTROL_STOP = 0x00
+MACRO_CONTROL_RUN = 0x01
+MACRO_CONTROL_STATUS = 0x02
+MACRO_CONTROL_PLAY_SLOT = 0x03
+MACRO_CONTROL_SAVE_SLOT = 0x04
+MACRO_CONTROL_DELETE_SLOT = 0x05
+MACRO_CONTROL_LIST = 0x06
+MACRO_LIBRARY_SLOTS = 8
+MACRO_NO_SLOT = 0xFF
+MACRO_RESULT_NAMES = {0: "ok", 1: "out of range", 2: "invalid", 3: "busy", 4: "flash error", 5: "empty slot"}
+MACRO_STATE_NAMES = {0: "idle", 1: "running", 2: "faulted"}
+RECORDER_CONTROL_STOP = 0x00
+RECORDER_CONTROL_RECORD = 0x01
+RECORDER_CONTROL_REPLAY = 0x02
+RECORDER_CONTROL_STATUS = 0x03
+RECORDER_CONTROL_READ = 0x04
+RECORDER_CONTROL_WRITE = 0x05
+RECORDER_RESULT_NAMES = {0: "ok", 1: "out of range", 2: "invalid", 3: "busy", 4: "empty"}
+RECORDER_STATE_NAMES = {0: "idle", 1: "recording", 2: "replaying"}
+STICK_CALIBRATION_CONTROL_STOP = 0x00
+STICK_CALIBRATION_CONTROL_LEARN = 0x01
+STICK_CALIBRATION_CONTROL_SAVE = 0x02
+STICK_CALIBRATION_CONTROL_CLEAR = 0x03
+STICK_CALIBRATION_CONTROL_STATUS = 0x04
+STICK_CALIBRATION_RESULT_NAMES = {0: "ok", 1: "invalid", 2: "range too small", 3: "store failed"}
+RUMBLE_FREQ_UNIT_HZ = 5
 UART_BAUD = 921600
 IMU_SAMPLES_PER_REPORT = 3
 
@@ -223,6 +332,47 @@ def str_to_dpad(flags: Mapping[str, bool]) -> SwitchDpad:
     return SwitchDpad.CENTER
 
 
+HAT_RAW = 0x80
+HAT_RAW_UP = 0x01
+HAT_RAW_DOWN = 0x02
+HAT_RAW_LEFT = 0x04
+HAT_RAW_RIGHT = 0x08
+INPUT_SLOT_UART = 0x01  # bits of the merge reply's active-slot mask
+INPUT_SLOT_PIO = 0x02
+INPUT_SLOT_GPIO = 0x04
+
+
+class SocdMode(IntEnum):
+    """How the Pico resolves opposing raw dpad directions (see ``raw_dpad``)."""
+
+    OFF = 0  # pass them through
+    LAST_INPUT = 1  # most recently pressed direction wins
+    NEUTRAL = 2  # opposing directions cancel out (firmware default)
+    UP_PRIORITY = 3  # up beats down; left + right cancel out
+
+
+class StickMergePolicy(IntEnum):
+    """Which input source drives each stick when several feed the Pico."""
+
+    PRIORITY = 0  # highest-priority source (UART1, then PIO, then GPIO) whose stick is off centre
+    MAX_MAGNITUDE = 1  # source pushing the stick furthest
+
+
+def raw_dpad(up: bool = False, down: bool = False, left: bool = False, right: bool = False) -> int:
+    """
+    Hat byte carrying raw directions, for sources such as hitbox-style
+    controllers that can hold opposing directions. The Pico's SOCD stage
+    decides what the console sees, with no extra host-side frame of latency.
+    """
+    return (
+        HAT_RAW
+        | (HAT_RAW_UP if up else 0)
+        | (HAT_RAW_DOWN if down else 0)
+        | (HAT_RAW_LEFT if left else 0)
+        | (HAT_RAW_RIGHT if right else 0)
+    )
+
+
 def compute_checksum(data: bytes) -> int:
     """Compute UART checksum as sum of bytes modulo 256."""
     return sum(data) & 0xFF
@@ -279,6 +429,418 @@ class SwitchReport:
         return frame + bytes([compute_checksum(frame)])
 
 
+def build_frame(frame_type: int, payload: bytes = b"") -> bytes:
+    """Frame a host -> Pico message: header, type, length, payload, checksum."""
+    if len(payload) > UART_FRAME_MAX_PAYLOAD:
+        raise ValueError(f"payload is {len(payload)} bytes; at most {UART_FRAME_MAX_PAYLOAD} fit a frame")
+    frame = bytes([UART_HEADER, frame_type & 0xFF, len(payload)]) + payload
+    return frame + bytes([compute_checksum(frame)])
+
+
+Color = Tuple[int, int, int]
+
+
+def parse_color(text: str) -> Color:
+    """Parse 'RRGGBB' (optionally prefixed with '#') into an RGB tuple."""
+    value = text.strip().lstrip("#")
+    if len(value) != 6:
+        raise ValueError(f"colour {text!r} must be 6 hex digits (RRGGBB)")
+    raw = bytes.fromhex(value)
+    return raw[0], raw[1], raw[2]
+
+
+def parse_mac(text: str) -> bytes:
+    """Parse 'aa:bb:cc:dd:ee:ff' (':' or '-' separated, or bare hex) into 6 bytes."""
+    raw = bytes.fromhex(text.replace(":", "").replace("-", ""))
+    if len(raw) != 6:
+        raise ValueError(f"MAC {text!r} must be 6 bytes")
+    return raw
+
+
+def random_mac(prefix: bytes = DEFAULT_MAC_PREFIX) -> bytes:
+    """Random device address keeping the given vendor prefix."""
+    return prefix + os.urandom(6 - len(prefix))
+
+
+def format_mac(mac: bytes) -> str:
+    return ":".join(f"{b:02x}" for b in mac)
+
+
+@dataclass
+class ControllerIdentity:
+    """
+    Per-unit identity stored in the Pico's flash: the MAC the console pairs
+    with, plus the serial, controller type and colours served over SPI.
+    """
+
+    mac: bytes = field(default_factory=random_mac)
+    controller_type: int = CONTROLLER_TYPE_PRO
+    serial: str = ""  # up to 16 ASCII characters; empty means none
+    body_color: Color = (0x1B, 0x1B, 0x1D)
+    button_color: Color = (0xFF, 0xFF, 0xFF)
+    left_grip_color: Color = (0x00, 0x89, 0xEB)
+    right_grip_color: Color = (0x00, 0x89, 0xEB)
+
+    def to_bytes(self) -> bytes:
+        """Serialize into the 35-byte record the firmware stores."""
+        if len(self.mac) != 6:
+            raise ValueError("MAC must be 6 bytes")
+        serial_bytes = self.serial.encode("ascii")
+        if len(serial_bytes) > 16:
+            raise ValueError("serial must be at most 16 ASCII characters")
+        serial_field = serial_bytes.ljust(16, b"\x00") if serial_bytes else b"\xff" * 16
+        colors = b"".join(
+            bytes(clamp_byte(c) for c in color)
+            for color in (self.body_color, self.button_color, self.left_grip_color, self.right_grip_color)
+        )
+        return bytes(self.mac) + bytes([self.controller_type & 0xFF]) + serial_field + colors
+
+    @classmethod
+    def from_bytes(cls, data: bytes) -> "ControllerIdentity":
+        if len(data) != IDENTITY_RECORD_LENGTH:
+            raise ValueError(f"identity record must be {IDENTITY_RECORD_LENGTH} bytes, got {len(data)}")
+        serial_field = data[7:23]
+        serial_text = "" if serial_field == b"\xff" * 16 else serial_field.rstrip(b"\x00\xff").decode("ascii", "replace")
+
+        def color(offset: int) -> Color:
+            return data[offset], data[offset + 1], data[offset + 2]
+
+        return cls(
+            mac=bytes(data[0:6]),
+            controller_type=data[6],
+            serial=serial_text,
+            body_color=color(23),
+            button_color=color(26),
+            left_grip_color=color(29),
+            right_grip_color=color(32),
+        )
+
+
+def decode_identity_reply(payload: bytes) -> Tuple[int, ControllerIdentity]:
+    """Split a PICO_REPLY_IDENTITY payload into (status, identity)."""
+    if len(payload) != PICO_FRAME_PAYLOAD_LENGTHS[PICO_REPLY_IDENTITY]:
+        raise ValueError("not an identity reply")
+    return payload[0], ControllerIdentity.from_bytes(payload[1:])
+
+
+class MacroOp(IntEnum):
+    END = 0x00
+    PRESS = 0x01
+    RELEASE = 0x02
+    HAT = 0x03
+    LSTICK = 0x04
+    RSTICK = 0x05
+    WAIT_US = 0x06
+    WAIT_REPORTS = 0x07
+    LOOP = 0x08
+    ENDLOOP = 0x09
+    JUMP = 0x0A
+    NEUTRAL = 0x0B
+
+
+@dataclass
+class MacroStatus:
+    result: int
+    state: int
+    pc: int
+    slot: int = MACRO_NO_SLOT  # library slot being played; MACRO_NO_SLOT for none or the RAM slot
+
+    @property
+    def ok(self) -> bool:
+        return self.result == 0
+
+    def __str__(self) -> str:
+        where = f" (slot {self.slot})" if self.slot != MACRO_NO_SLOT else ""
+        return (
+            f"{MACRO_RESULT_NAMES.get(self.result, self.result)}, "
+            f"{MACRO_STATE_NAMES.get(self.state, self.state)} at 0x{self.pc:03x}{where}"
+        )
+
+
+@dataclass
+class MacroSlot:
+    """A macro saved in the Pico's flash library."""
+
+    slot: int
+    length: int  # 0 = empty
+    chord: int  # SwitchButton mask that triggers it from the host's input, 0 = none
+    name: str
+
+    @classmethod
+    def from_bytes(cls, payload: bytes) -> "MacroSlot":
+        if len(payload) != PICO_FRAME_PAYLOAD_LENGTHS[PICO_REPLY_MACRO_SLOT]:
+            raise ValueError(f"macro slot reply must be {PICO_FRAME_PAYLOAD_LENGTHS[PICO_REPLY_MACRO_SLOT]} bytes")
+        slot, length, chord = struct.unpack_from("<BHH", payload)
+        name = payload[5:].split(b"\x00", 1)[0].decode("utf-8", errors="replace")
+        return cls(slot, length, chord, name)
+
+
+@dataclass
+class RecordedRun:
+    """
+    A run of identical 0x30 reports captured by the Pico's input recorder.
+    Sticks are the 12-bit values the console received (0-4095, 2048 = centre).
+    The Pico records the dpad as raw directions (see ``raw_dpad``); either
+    that or a ``SwitchDpad`` value can be loaded for a replay.
+    """
+
+    report: int  # Pico report counter at the first report of the run
+    repeat: int  # number of consecutive reports
+    buttons: int = 0
+    hat: int = SwitchDpad.CENTER
+    lx: int = 2048
+    ly: int = 2048
+    rx: int = 2048
+    ry: int = 2048
+
+    def to_bytes(self) -> bytes:
+        if not 1 <= self.repeat <= 0xFFFF:
+            raise ValueError("repeat must be 1-65535")
+        for value in (self.lx, self.ly, self.rx, self.ry):
+            if not 0 <= value <= 0xFFF:
+                raise ValueError("stick values are 12-bit")
+        left = self.lx | (self.ly << 12)
+        right = self.rx | (self.ry << 12)
+        return (
+            struct.pack("<IHHB", self.report & 0xFFFFFFFF, self.repeat, int(self.buttons), int(self.hat))
+            + left.to_bytes(3, "little")
+            + right.to_bytes(3, "little")
+            + b"\x00"
+        )
+
+    @classmethod
+    def from_bytes(cls, data: bytes) -> "RecordedRun":
+        if len(data) != RECORDED_RUN_LENGTH:
+            raise ValueError(f"a recorded run is {RECORDED_RUN_LENGTH} bytes")
+        report, repeat, buttons, hat = struct.unpack_from("<IHHB", data)
+        left = int.from_bytes(data[9:12], "little")
+        right = int.from_bytes(data[12:15], "little")
+        return cls(report, repeat, buttons, hat, left & 0xFFF, left >> 12, right & 0xFFF, right >> 12)
+
+
+@dataclass
+class RecorderStatus:
+    result: int
+    state: int
+    runs: int
+    position: int
+    report_count: int
+
+    @property
+    def ok(self) -> bool:
+        return self.result == 0
+
+    def __str__(self) -> str:
+        return (
+            f"{RECORDER_RESULT_NAMES.get(self.result, self.result)}, "
+            f"{RECORDER_STATE_NAMES.get(self.state, self.state)} with {self.runs} runs "
+            f"(position {self.position}, report {self.report_count})"
+        )
+
+
+@dataclass
+class StickCalibrationStatus:
+    """
+    Stick calibration learning state. Ranges are (min, centre, max) per axis in
+    the input report's 12-bit units, all zero until a stick has been observed.
+    """
+
+    result: int
+    learning: bool
+    saved: int  # STICK_LEFT / STICK_RIGHT bits stored by a save
+    left_x: Tuple[int, int, int]
+    left_y: Tuple[int, int, int]
+    right_x: Tuple[int, int, int]
+    right_y: Tuple[int, int, int]
+
+    @classmethod
+    def from_bytes(cls, payload: bytes) -> "StickCalibrationStatus":
+        result, learning, saved = payload[0], payload[1], payload[2]
+        values = struct.unpack_from("<12H", payload, 3)
+        return cls(result, bool(learning), saved, values[0:3], values[3:6], values[6:9], values[9:12])
+
+    @property
+    def ok(self) -> bool:
+        return self.result == 0
+
+    def __str__(self) -> str:
+        return (
+            f"{STICK_CALIBRATION_RESULT_NAMES.get(self.result, self.result)}, "
+            f"{'learning' if self.learning else 'idle'}: left x {self.left_x} y {self.left_y}, "
+            f"right x {self.right_x} y {self.right_y}"
+        )
+
+
+def decode_recorded_runs(payload: bytes) -> Tuple[int, List[RecordedRun]]:
+    """Split a PICO_REPLY_RECORDER_RUNS payload into (index, runs)."""
+    index, count = struct.unpack_from("<HB", payload)
+    runs = [
+        RecordedRun.from_bytes(payload[3 + i * RECORDED_RUN_LENGTH : 3 + (i + 1) * RECORDED_RUN_LENGTH])
+        for i in range(min(count, RECORDER_RUNS_PER_FRAME))
+    ]
+    return index, runs
+
+
+def turbo_payload(buttons: Union[SwitchButton, int], on_reports: int, off_reports: int) -> bytes:
+    """Build a UART_FRAME_TURBO payload; on_reports=0 turns turbo off for those buttons."""
+    if not 0 <= on_reports <= 255 or not 0 <= off_reports <= 255:
+        raise ValueError("turbo rates are 0-255 reports")
+    if on_reports and not off_reports:
+        raise ValueError("turbo needs at least one report off")
+    return struct.pack("<HBB", int(buttons) & 0xFFFF, on_reports, off_reports)
+
+
+STICK_LEFT = 0x01
+STICK_RIGHT = 0x02
+STICK_SHAPE_RADIAL = 0x01
+STICK_SHAPE_CIRCLE = 0x02
+
+
+@dataclass
+class StickShape:
+    """Firmware stick response; every field is percent of full deflection."""
+
+    deadzone: int = 0
+    anti_deadzone: int = 0
+    saturation: int = 100  # deflection that already counts as full
+    expo: int = 0  # 0 = linear, 100 = cubic (finer control near the centre)
+    radial: bool = False  # shape the stick's length rather than each axis, so diagonals do not snap
+    circle: bool = False  # radial only: map a square gate onto the Pro Controller's circle
+
+    def to_bytes(self) -> bytes:
+        if not (0 <= self.deadzone < self.saturation <= 100 and 0 <= self.anti_deadzone < 100 and 0 <= self.expo <= 100):
+            raise ValueError("stick shape needs 0 <= deadzone < saturation <= 100, anti_deadzone < 100, expo <= 100")
+        if self.circle and not self.radial:
+            raise ValueError("square-to-circle mapping needs radial shaping")
+        flags = (STICK_SHAPE_RADIAL if self.radial else 0) | (STICK_SHAPE_CIRCLE if self.circle else 0)
+        return bytes([self.deadzone, self.anti_deadzone, self.saturation, self.expo, flags])
+
+
+def stick_shape_payload(sticks: int, shape: StickShape) -> bytes:
+    """Build a UART_FRAME_STICK_SHAPE payload for STICK_LEFT and/or STICK_RIGHT."""
+    if not sticks or sticks & ~(STICK_LEFT | STICK_RIGHT):
+        raise ValueError("sticks must be STICK_LEFT, STICK_RIGHT or both")
+    return bytes([sticks]) + shape.to_bytes()
+
+
+def macro_save_payload(slot: int, length: int, name: str = "", chord: int = 0) -> bytes:
+    """Build a MACRO_CONTROL_SAVE_SLOT payload for the program already in the RAM slot."""
+    if not 0 <= slot < MACRO_LIBRARY_SLOTS:
+        raise ValueError(f"slot must be 0-{MACRO_LIBRARY_SLOTS - 1}")
+    encoded = name.encode("utf-8")
+    if len(encoded) > MACRO_NAME_LENGTH:
+        raise ValueError(f"macro name is limited to {MACRO_NAME_LENGTH} bytes")
+    chord = int(chord)
+    if chord and chord & (chord - 1) == 0:
+        raise ValueError("a chord needs at least two buttons")
+    return struct.pack("<BBHH", MACRO_CONTROL_SAVE_SLOT, slot, length, chord) + encoded
+
+
+class MacroBuilder:
+    """
+    Assemble bytecode for the Pico's macro player. Timing is executed on the
+    Pico against its own report clock, so it is exact to the report.
+
+    Example:
+        macro = MacroBuilder()
+        with macro.loop(10):
+            macro.press(SwitchButton.A).wait_reports(2).release(SwitchButton.A).wait_ms(100)
+        client.run_macro(macro.build())
+    """
+
+    def __init__(self) -> None:
+        self._code = bytearray()
+        # Labels and jumps remember the LOOP they sit in (None = top level);
+        # the Pico rejects a jump into or out of a loop body.
+        self._labels: Dict[str, Tuple[int, Optional[int]]] = {}
+        self._fixups: List[Tuple[int, str, Optional[int]]] = []
+        self._open_loops: List[int] = []
+        self._last_op: Optional[MacroOp] = None
+
+    def _emit(self, op: MacroOp, operands: bytes = b"") -> "MacroBuilder":
+        self._code += bytes([op]) + operands
+        self._last_op = op
+        return self
+
+    def press(self, *buttons: Union[SwitchButton, int]) -> "MacroBuilder":
+        return self._emit(MacroOp.PRESS, struct.pack("<H", _button_mask(buttons)))
+
+    def release(self, *buttons: Union[SwitchButton, int]) -> "MacroBuilder":
+        return self._emit(MacroOp.RELEASE, struct.pack("<H", _button_mask(buttons)))
+
+    def hat(self, hat: Union[SwitchDpad, int]) -> "MacroBuilder":
+        return self._emit(MacroOp.HAT, bytes([int(hat) & 0xFF]))
+
+    def left_stick(self, x: Union[int, float], y: Union[int, float]) -> "MacroBuilder":
+        return self._emit(MacroOp.LSTICK, bytes([normalize_stick_value(x), normalize_stick_value(y)]))
+
+    def right_stick(self, x: Union[int, float], y: Union[int, float]) -> "MacroBuilder":
+        return self._emit(MacroOp.RSTICK, bytes([normalize_stick_value(x), normalize_stick_value(y)]))
+
+    def wait_us(self, microseconds: int) -> "MacroBuilder":
+        return self._emit(MacroOp.WAIT_US, struct.pack("<I", max(0, int(microseconds))))
+
+    def wait_ms(self, milliseconds: float) -> "MacroBuilder":
+        return self.wait_us(int(milliseconds * 1000))
+
+    def wait_reports(self, reports: int) -> "MacroBuilder":
+        return self._emit(MacroOp.WAIT_REPORTS, struct.pack("<H", reports))
+
+    def neutral(self) -> "MacroBuilder":
+        return self._emit(MacroOp.NEUTRAL)
+
+    def label(self, name: str) -> "MacroBuilder":
+        self._labels[name] = (len(self._code), self._enclosing_loop())
+        return self
+
+    def jump(self, label: str) -> "MacroBuilder":
+        self._fixups.append((len(self._code) + 1, label, self._enclosing_loop()))
+        return self._emit(MacroOp.JUMP, b"\x00\x00")
+
+    @contextmanager
+    def loop(self, count: int = 0):
+        """Repeat the enclosed block count times (0 = forever)."""
+        self._open_loops.append(len(self._code))
+        self._emit(MacroOp.LOOP, struct.pack("<H", count))
+        yield self
+        self._emit(MacroOp.ENDLOOP)
+        self._open_loops.pop()
+
+    def _enclosing_loop(self) -> Optional[int]:
+        return self._open_loops[-1] if self._open_loops else None
+
+    def end(self) -> "MacroBuilder":
+        return self._emit(MacroOp.END)
+
+    def build(self) -> bytes:
+        code = bytearray(self._code)
+        if self._last_op != MacroOp.END:
+            code.append(MacroOp.END)
+        for offset, label, loop in self._fixups:
+            if label not in self._labels:
+                raise ValueError(f"unknown macro label {label!r}")
+            target, target_loop = self._labels[label]
+            if target_loop != loop:
+                raise ValueError(f"jump to macro label {label!r} crosses a loop boundary")
+            struct.pack_into("<H", code, offset, target)
+        if len(code) > MACRO_SLOT_SIZE:
+            raise ValueError(f"macro is {len(code)} bytes; the Pico's slot holds {MACRO_SLOT_SIZE}")
+        return bytes(code)
+
+
+def _button_mask(buttons: Iterable[Union[SwitchButton, int]]) -> int:
+    mask = 0
+    for button in buttons:
+        mask |= int(button)
+    return mask & 0xFFFF
+
+
+def macro_upload_frames(program: bytes) -> List[bytes]:
+    """Split a program into UART_FRAME_MACRO_UPLOAD payloads (offset + chunk)."""
+    chunk = UART_FRAME_MAX_PAYLOAD - 2
+    return [struct.pack("<H", offset) + program[offset : offset + chunk] for offset in range(0, len(program), chunk)]
+
+
 class PicoUART:
     def __init__(self, port: str, baudrate: int = UART_BAUD) -> None:
         """Open a UART connection to the Pico with non-blocking IO."""
@@ -300,16 +862,59 @@ class PicoUART:
         """Send a controller report to the Pico."""
         self.serial.write(report.to_bytes())
 
+    def send_frame(self, frame_type: int, payload: bytes = b"") -> None:
+        """Send a non-input message (see ``build_frame``)."""
+        self.serial.write(build_frame(frame_type, payload))
+
+    def send_identity(self, identity: ControllerIdentity) -> None:
+        """Ask the Pico to store a new identity; it replies and then reboots into it."""
+        self.send_frame(UART_FRAME_IDENTITY_SET, identity.to_bytes())
+
+    def request_identity(self) -> None:
+        """Ask the Pico for its stored identity; answered with a PICO_REPLY_IDENTITY frame."""
+        self.send_frame(UART_FRAME_IDENTITY_GET)
+
+    def read_macro_status(self, timeout: float) -> Optional[MacroStatus]:
+        payload = self.wait_for_frame(PICO_REPLY_MACRO, timeout)
+        if payload is None:
+            return None
+        return MacroStatus(payload[0], payload[1], payload[2] | (payload[3] << 8), payload[4])
+
+    def read_recorder_status(self, timeout: float) -> Optional[RecorderStatus]:
+        payload = self.wait_for_frame(PICO_REPLY_RECORDER, timeout)
+        if payload is None:
+            return None
+        return RecorderStatus(*struct.unpack("<BBHHI", payload))
+
+    def read_stick_calibration_status(self, timeout: float) -> Optional[StickCalibrationStatus]:
+        payload = self.wait_for_frame(PICO_REPLY_STICK_CALIBRATION, timeout)
+        if payload is None:
+            return None
+        return StickCalibrationStatus.from_bytes(payload)
+
     def read_rumble_payload(self) -> Optional[bytes]:
         """
         Drain available UART bytes into an internal buffer, then extract one rumble frame.
 
         Frame format:
           0: 0xBB (RUMBLE_HEADER)
-          1: type (0x01 for rumble)
-          2-9: 8-byte rumble payload
-          10: checksum (sum of first 10 bytes) & 0xFF
+          1: type (RUMBLE_TYPE_RUMBLE, RUMBLE_TYPE_COMPACT or RUMBLE_TYPE_TIMED)
+          2..: payload (8 raw rumble bytes, 4 compact band bytes, or 10 timed bytes)
+          last: checksum (sum of all preceding bytes) & 0xFF
+
+        The payload length identifies the frame type; pass it to ``decode_rumble``.
+        Non-rumble frames (such as identity replies) are skipped.
         """
+        while True:
+            frame = self.read_frame()
+            if frame is None:
+                return None
+            frame_type, payload = frame
+            if frame_type in RUMBLE_PAYLOAD_LENGTHS:
+                return payload
+
+    def read_frame(self) -> Optional[Tuple[int, bytes]]:
+        """Drain available UART bytes and extract one Pico -> host frame as (type, payload)."""
         waiting = self.serial.in_waiting
         if waiting:
             self._buffer.extend(self.serial.read(waiting))
@@ -323,28 +928,71 @@ class PicoUART:
                 self._buffer.clear()
                 return None
 
-            if len(self._buffer) - start < 11:
+            if len(self._buffer) - start < 2:
                 if start > 0:
                     del self._buffer[:start]
                 return None
 
-            frame = self._buffer[start : start + 11]
-            checksum = compute_checksum(bytes(frame[:10]))
+            frame_type = self._buffer[start + 1]
+            payload_len = PICO_FRAME_PAYLOAD_LENGTHS.get(frame_type)
+            if payload_len is None:
+                del self._buffer[: start + 1]
+                continue
 
-            if frame[1] == RUMBLE_TYPE_RUMBLE and checksum == frame[10]:
-                payload = bytes(frame[2:10])
-                del self._buffer[: start + 11]
-                return payload
+            frame_len = payload_len + 3
+            if len(self._buffer) - start < frame_len:
+                if start > 0:
+                    del self._buffer[:start]
+                return None
+
+            frame = self._buffer[start : start + frame_len]
+            checksum = compute_checksum(bytes(frame[:-1]))
+
+            if checksum == frame[-1]:
+                payload = bytes(frame[2:-1])
+                del self._buffer[: start + frame_len]
+                return frame_type, payload
 
             del self._buffer[: start + 1]
 
+    def wait_for_frame(self, frame_type: int, timeout: float) -> Optional[bytes]:
+        """Poll until a frame of frame_type arrives (payload) or timeout elapses (None)."""
+        deadline = time.monotonic() + timeout
+        while True:
+            frame = self.read_frame()
+            if frame is not None:
+                if frame[0] == frame_type:
+                    return frame[1]
+                continue
+            if time.monotonic() >= deadline:
+                return None
+            time.sleep(0.001)
+
     def close(self) -> None:
         """Close the UART connection."""
         self.serial.close()
 
 
+def _compact_bands(payload: bytes) -> Optional[bytes]:
+    """Return the 4 band bytes of a compact or timed payload, else None."""
+    if len(payload) in (
+        RUMBLE_PAYLOAD_LENGTHS[RUMBLE_TYPE_COMPACT],
+        RUMBLE_PAYLOAD_LENGTHS[RUMBLE_TYPE_TIMED],
+    ):
+        return payload[:4]
+    return None
+
+
 def decode_rumble(payload: bytes) -> Tuple[float, float]:
-    """Return normalized rumble amplitudes (0.0-1.0) for left/right."""
+    """
+    Return normalized rumble amplitudes (0.0-1.0).
+
+    Compact and timed payloads (decoded by the firmware) give (low band, high band);
+    raw 8-byte payloads from older firmware give (left, right).
+    """
+    bands = _compact_bands(payload)
+    if bands is not None:
+        return bands[0] / 255.0, bands[2] / 255.0
     if len(payload) < 8:
         return 0.0, 0.0
     if payload == b"\x00\x01\x40\x40\x00\x01\x40\x40":
@@ -358,6 +1006,109 @@ def decode_rumble(payload: bytes) -> Tuple[float, float]:
     return left, right
 
 
+def decode_rumble_frequencies(payload: bytes) -> Optional[Tuple[int, int]]:
+    """Return (low band, high band) frequencies in Hz for a compact payload, else None."""
+    bands = _compact_bands(payload)
+    if bands is None:
+        return None
+    return bands[1] * RUMBLE_FREQ_UNIT_HZ, bands[3] * RUMBLE_FREQ_UNIT_HZ
+
+
+def decode_rumble_timestamp(payload: bytes) -> Optional[Tuple[int, int]]:
+    """Return (USB arrival time, dwell) in Pico microseconds for a timed payload, else None."""
+    if len(payload) != RUMBLE_PAYLOAD_LENGTHS[RUMBLE_TYPE_TIMED]:
+        return None
+    arrival_us, dwell_us = struct.unpack_from("<IH", payload, 4)
+    return arrival_us, dwell_us
+
+
+class RumbleLatencyTracker:
+    """
+    Histogram of Switch rumble latency: from the USB OUT report reaching the Pico
+    to the host finishing ``apply_rumble``.
+
+    The Pico and host clocks are aligned by tracking the smallest observed
+    (host receive - Pico transmit) gap over a sliding window, so the numbers are
+    relative to the best-case serial transport seen in that window.
+    """
+
+    BUCKET_EDGES_MS = (1.0, 2.0, 4.0, 8.0, 16.0, 32.0, 64.0)
+
+    def __init__(self, window: float = 10.0) -> None:
+        self.window = window
+        self.counts = [0] * (len(self.BUCKET_EDGES_MS) + 1)
+        self.samples = 0
+        self.total_ms = 0.0
+        self.max_ms = 0.0
+        self._offsets: deque = deque()
+        self._epoch_us = 0
+        self._last_raw_us: Optional[int] = None
+        self._last_arrival_us: Optional[int] = None
+
+    def _unwrap(self, raw_us: int) -> int:
+        # The Pico's 32-bit microsecond clock wraps every ~71 minutes.
+        if self._last_raw_us is not None and raw_us < self._last_raw_us - (1 << 31):
+            self._epoch_us += 1 << 32
+        self._last_raw_us = raw_us
+        return self._epoch_us + raw_us
+
+    def observe_frame(self, payload: bytes, host_received: float) -> Optional[float]:
+        """
+        Feed every received payload with its host receive time (seconds).
+
+        Returns the estimated host-clock arrival time for new timed frames, or None
+        for untimed frames and periodic refreshes of an already-seen report.
+        """
+        stamp = decode_rumble_timestamp(payload)
+        if stamp is None:
+            return None
+        arrival_raw, dwell_us = stamp
+        arrival_us = self._unwrap(arrival_raw)
+        sent_s = (arrival_us + dwell_us) / 1_000_000.0
+        offset = host_received - sent_s
+        while self._offsets and self._offsets[0][0] < host_received - self.window:
+            self._offsets.popleft()
+        while self._offsets and self._offsets[-1][1] >= offset:
+            self._offsets.pop()
+        self._offsets.append((host_received, offset))
+
+        if arrival_us == self._last_arrival_us:
+            return None
+        self._last_arrival_us = arrival_us
+        return arrival_us / 1_000_000.0 + self._offsets[0][1]
+
+    def record_applied(self, arrival: float, applied: float) -> None:
+        """Record one sample: ``arrival`` from observe_frame, ``applied`` after apply_rumble returns."""
+        latency_ms = max(0.0, (applied - arrival) * 1000.0)
+        bucket = len(self.BUCKET_EDGES_MS)
+        for idx, edge in enumerate(self.BUCKET_EDGES_MS):
+            if latency_ms < edge:
+                bucket = idx
+                break
+        self.counts[bucket] += 1
+        self.samples += 1
+        self.total_ms += latency_ms
+        self.max_ms = max(self.max_ms, latency_ms)
+
+    def format_histogram(self) -> List[str]:
+        """Return human-readable histogram lines (empty if nothing was recorded)."""
+        if not self.samples:
+            return []
+        lines = [
+            f"rumble latency: n={self.samples} mean={self.total_ms / self.samples:.2f}ms max={self.max_ms:.2f}ms"
+        ]
+        lower = 0.0
+        for idx, count in enumerate(self.counts):
+            if idx < len(self.BUCKET_EDGES_MS):
+                label = f"{lower:>4g}-{self.BUCKET_EDGES_MS[idx]:<4g}ms"
+                lower = self.BUCKET_EDGES_MS[idx]
+            else:
+                label = f"  >={lower:<4g}ms"
+            bar = "#" * max(1 if count else 0, round(40 * count / self.samples))
+            lines.append(f"  {label} {count:>6} {bar}")
+        return lines
+
+
 @dataclass
 class SwitchControllerState:
     """Mutable controller state with helpers for building reports."""
@@ -390,6 +1141,10 @@ class SwitchControllerState:
         """Set the DPAD/hat value directly."""
         self.report.hat = SwitchDpad(int(hat) & 0xFF)
 
+    def set_raw_dpad(self, up: bool = False, down: bool = False, left: bool = False, right: bool = False) -> None:
+        """Send dpad directions as-is, opposing ones included; the Pico applies its SOCD mode."""
+        self.report.hat = raw_dpad(up, down, left, right)
+
     def move_left_stick(self, x: Union[int, float], y: Union[int, float]) -> None:
         """Move the left stick using normalized floats (-1..1) or raw bytes (0-255)."""
         self.report.lx = normalize_stick_value(x)
@@ -436,6 +1191,8 @@ class SwitchUARTClient:
             send_interval: Minimum interval between sends in seconds (defaults to 500 Hz).
             auto_send: If True, keep sending the current state in a background thread so the
                        Pico continuously sees the latest input (mirrors controller_uart_bridge).
+                       Without it, call send() at least every 500 ms: the Pico drops the
+                       input of a host that goes quiet for longer.
         """
         self.uart = PicoUART(port, baud)
         self.state = SwitchControllerState()
@@ -487,6 +1244,33 @@ class SwitchUARTClient:
         self.state.set_hat(hat)
         self.send()
 
+    def set_raw_dpad(self, up: bool = False, down: bool = False, left: bool = False, right: bool = False) -> None:
+        self.state.set_raw_dpad(up, down, left, right)
+        self.send()
+
+    def set_socd_mode(self, mode: SocdMode, timeout: float = 0.5) -> SocdMode:
+        """Choose how the Pico resolves opposing raw dpad directions."""
+        self.uart.send_frame(UART_FRAME_SOCD, bytes([int(mode)]))
+        payload = self.uart.wait_for_frame(PICO_REPLY_SOCD, timeout)
+        if payload is None:
+            raise TimeoutError("no reply to SOCD config")
+        if not payload[0]:
+            raise ValueError(f"the Pico rejected SOCD mode {mode!r}")
+        return SocdMode(payload[1])
+
+    def set_stick_merge(self, policy: StickMergePolicy, timeout: float = 0.5) -> Tuple[StickMergePolicy, int]:
+        """
+        Choose how the Pico combines sticks from its input sources. Returns the
+        policy in force and the sources currently taking part (INPUT_SLOT_* bits).
+        """
+        self.uart.send_frame(UART_FRAME_MERGE, bytes([int(policy)]))
+        payload = self.uart.wait_for_frame(PICO_REPLY_MERGE, timeout)
+        if payload is None:
+            raise TimeoutError("no reply to merge config")
+        if not payload[0]:
+            raise ValueError(f"the Pico rejected stick merge policy {policy!r}")
+        return StickMergePolicy(payload[1]), payload[2]
+
     def move_left_stick(self, x: Union[int, float], y: Union[int, float]) -> None:
         self.state.move_left_stick(x, y)
         self.send()
@@ -537,7 +1321,8 @@ class SwitchUARTClient:
 
     def poll_rumble(self) -> Optional[Tuple[float, float]]:
         """
-        Poll for the latest rumble payload and return normalized amplitudes.
+        Poll for the latest rumble payload and return normalized amplitudes
+        (low/high band with current firmware, see ``decode_rumble``).
         Returns None if no rumble frame was available.
         """
         payload = self.uart.read_rumble_payload()
@@ -545,6 +1330,203 @@ class SwitchUARTClient:
             return decode_rumble(payload)
         return None
 
+    def read_identity(self, timeout: float = 1.0) -> Optional[Tuple[int, ControllerIdentity]]:
+        """Return (status, identity) stored on the Pico, or None if it did not answer."""
+        self.uart.request_identity()
+        payload = self.uart.wait_for_frame(PICO_REPLY_IDENTITY, timeout)
+        return decode_identity_reply(payload) if payload else None
+
+    def write_identity(
+        self, identity: ControllerIdentity, timeout: float = 1.0
+    ) -> Optional[Tuple[int, ControllerIdentity]]:
+        """
+        Store a new identity. The reply status is IDENTITY_STATUS_PENDING when
+        accepted (the Pico reboots into it moments later) or
+        IDENTITY_STATUS_REJECTED. Returns None if the Pico did not answer.
+        """
+        self.uart.send_identity(identity)
+        payload = self.uart.wait_for_frame(PICO_REPLY_IDENTITY, timeout)
+        return decode_identity_reply(payload) if payload else None
+
+    def upload_macro(self, program: bytes, timeout: float = 0.5) -> MacroStatus:
+        """Copy a program into the Pico's RAM macro slot, one acknowledged frame at a time."""
+        status = MacroStatus(0, 0, 0)
+        for payload in macro_upload_frames(program):
+            self.uart.send_frame(UART_FRAME_MACRO_UPLOAD, payload)
+            reply = self.uart.read_macro_status(timeout)
+            if reply is None:
+                raise TimeoutError("no reply to macro upload")
+            if not reply.ok:
+                return reply
+            status = reply
+        return status
+
+    def run_macro(self, program: bytes, timeout: float = 0.5) -> MacroStatus:
+        """Upload and start a program built with ``MacroBuilder``."""
+        status = self.upload_macro(program, timeout)
+        if not status.ok:
+            return status
+        return self._macro_control(bytes([MACRO_CONTROL_RUN]) + struct.pack("<H", len(program)), timeout)
+
+    def stop_macro(self, timeout: float = 0.5) -> MacroStatus:
+        return self._macro_control(bytes([MACRO_CONTROL_STOP]), timeout)
+
+    def macro_status(self, timeout: float = 0.5) -> MacroStatus:
+        return self._macro_control(bytes([MACRO_CONTROL_STATUS]), timeout)
+
+    def save_macro(
+        self, slot: int, program: bytes, name: str = "", chord: Union[SwitchButton, int] = 0, timeout: float = 0.5
+    ) -> MacroStatus:
+        """
+        Store a program in a flash library slot. With a chord, pressing those
+        buttons together in the host's input starts (or stops) the macro on the
+        Pico. The Pico replies once the slot is written, between input reports.
+        """
+        payload = macro_save_payload(slot, len(program), name, chord)
+        status = self.upload_macro(program, timeout)
+        if not status.ok:
+            return status
+        return self._macro_control(payload, timeout)
+
+    def play_macro_slot(self, slot: int, timeout: float = 0.5) -> MacroStatus:
+        return self._macro_control(bytes([MACRO_CONTROL_PLAY_SLOT, slot]), timeout)
+
+    def delete_macro_slot(self, slot: int, timeout: float = 0.5) -> MacroStatus:
+        return self._macro_control(bytes([MACRO_CONTROL_DELETE_SLOT, slot]), timeout)
+
+    def list_macros(self, timeout: float = 0.5) -> List[MacroSlot]:
+        """Return the saved macros (empty slots omitted)."""
+        self.uart.send_frame(UART_FRAME_MACRO_CONTROL, bytes([MACRO_CONTROL_LIST]))
+        slots = []
+        for _ in range(MACRO_LIBRARY_SLOTS):
+            payload = self.uart.wait_for_frame(PICO_REPLY_MACRO_SLOT, timeout)
+            if payload is None:
+                raise TimeoutError("no reply to macro list")
+            info = MacroSlot.from_bytes(payload)
+            if info.length:
+                slots.append(info)
+        if self.uart.read_macro_status(timeout) is None:
+            raise TimeoutError("no reply to macro list")
+        return slots
+
+    def set_turbo(
+        self, buttons: Union[SwitchButton, int], on_reports: int = 1, off_reports: int = 1, timeout: float = 0.5
+    ) -> int:
+        """
+        Make the Pico rapid-fire these buttons while they are held: on for
+        on_reports 0x30 reports, then off for off_reports (about 8 ms each
+        at the default USB polling rate). Returns the turbo-enabled buttons.
+        """
+        self.uart.send_frame(UART_FRAME_TURBO, turbo_payload(buttons, on_reports, off_reports))
+        payload = self.uart.wait_for_frame(PICO_REPLY_TURBO, timeout)
+        if payload is None:
+            raise TimeoutError("no reply to turbo config")
+        if not payload[0]:
+            raise ValueError("the Pico rejected the turbo config")
+        return payload[1] | (payload[2] << 8)
+
+    def clear_turbo(self, buttons: Union[SwitchButton, int] = 0xFFFF, timeout: float = 0.5) -> int:
+        """Turn turbo off for these buttons (all by default)."""
+        return self.set_turbo(buttons, 0, 0, timeout)
+
+    def set_stick_shape(
+        self, shape: StickShape, sticks: int = STICK_LEFT | STICK_RIGHT, timeout: float = 0.5
+    ) -> None:
+        """Have the Pico shape stick input (deadzone, curve, ...); StickShape() restores raw input."""
+        self.uart.send_frame(UART_FRAME_STICK_SHAPE, stick_shape_payload(sticks, shape))
+        payload = self.uart.wait_for_frame(PICO_REPLY_STICK_SHAPE, timeout)
+        if payload is None:
+            raise TimeoutError("no reply to stick shape config")
+        if not payload[0]:
+            raise ValueError("the Pico rejected the stick shape")
+
+    def start_recording(self, timeout: float = 0.5) -> RecorderStatus:
+        """Clear the Pico's recording and capture every report from the next one on."""
+        return self._recorder_control(bytes([RECORDER_CONTROL_RECORD]), timeout)
+
+    def stop_recording(self, timeout: float = 0.5) -> RecorderStatus:
+        """Stop recording or replaying."""
+        return self._recorder_control(bytes([RECORDER_CONTROL_STOP]), timeout)
+
+    def replay_recording(self, timeout: float = 0.5) -> RecorderStatus:
+        """Replay the recording, one run report after report, from the next report."""
+        return self._recorder_control(bytes([RECORDER_CONTROL_REPLAY]), timeout)
+
+    def recorder_status(self, timeout: float = 0.5) -> RecorderStatus:
+        return self._recorder_control(bytes([RECORDER_CONTROL_STATUS]), timeout)
+
+    def read_recording(self, timeout: float = 0.5) -> List[RecordedRun]:
+        """Download the recording, oldest run first. Stop recording first for a stable copy."""
+        total = self.recorder_status(timeout).runs
+        runs: List[RecordedRun] = []
+        while len(runs) < total:
+            self.uart.send_frame(UART_FRAME_RECORDER, struct.pack("<BH", RECORDER_CONTROL_READ, len(runs)))
+            payload = self.uart.wait_for_frame(PICO_REPLY_RECORDER_RUNS, timeout)
+            if payload is None:
+                raise TimeoutError("no reply to recording read")
+            index, chunk = decode_recorded_runs(payload)
+            if index != len(runs) or not chunk:
+                break  # the ring changed underneath us
+            runs.extend(chunk)
+        return runs
+
+    def load_recording(self, runs: Iterable[RecordedRun], timeout: float = 0.5) -> RecorderStatus:
+        """Replace the Pico's recording, e.g. with a saved or hand-written input file."""
+        encoded = [run.to_bytes() for run in runs]
+        status = None
+        for index in range(0, max(len(encoded), 1), RECORDER_RUNS_PER_FRAME):
+            chunk = b"".join(encoded[index : index + RECORDER_RUNS_PER_FRAME])
+            status = self._recorder_control(struct.pack("<BH", RECORDER_CONTROL_WRITE, index) + chunk, timeout)
+            if not status.ok:
+                break
+        return status
+
+    def _recorder_control(self, payload: bytes, timeout: float) -> RecorderStatus:
+        self.uart.send_frame(UART_FRAME_RECORDER, payload)
+        reply = self.uart.read_recorder_status(timeout)
+        if reply is None:
+            raise TimeoutError("no reply to recorder command")
+        return reply
+
+    def learn_stick_calibration(self, timeout: float = 0.5) -> StickCalibrationStatus:
+        """
+        Start learning the sticks' real range. Leave both sticks at rest when
+        calling this, then roll each around its full range a few times.
+        """
+        return self._stick_calibration_control(STICK_CALIBRATION_CONTROL_LEARN, timeout)
+
+    def stop_stick_calibration(self, timeout: float = 0.5) -> StickCalibrationStatus:
+        """Stop learning without saving."""
+        return self._stick_calibration_control(STICK_CALIBRATION_CONTROL_STOP, timeout)
+
+    def save_stick_calibration(self, timeout: float = 0.5) -> StickCalibrationStatus:
+        """
+        Store the learned ranges as the controller's user stick calibration.
+        It survives reboots; the console picks it up when it next connects.
+        """
+        return self._stick_calibration_control(STICK_CALIBRATION_CONTROL_SAVE, timeout)
+
+    def clear_stick_calibration(self, timeout: float = 0.5) -> StickCalibrationStatus:
+        """Drop the user stick calibration and go back to the factory one."""
+        return self._stick_calibration_control(STICK_CALIBRATION_CONTROL_CLEAR, timeout)
+
+    def stick_calibration_status(self, timeout: float = 0.5) -> StickCalibrationStatus:
+        return self._stick_calibration_control(STICK_CALIBRATION_CONTROL_STATUS, timeout)
+
+    def _stick_calibration_control(self, command: int, timeout: float) -> StickCalibrationStatus:
+        self.uart.send_frame(UART_FRAME_STICK_CALIBRATION, bytes([command]))
+        reply = self.uart.read_stick_calibration_status(timeout)
+        if reply is None:
+            raise TimeoutError("no reply to stick calibration command")
+        return reply
+
+    def _macro_control(self, payload: bytes, timeout: float) -> MacroStatus:
+        self.uart.send_frame(UART_FRAME_MACRO_CONTROL, payload)
+        reply = self.uart.read_macro_status(timeout)
+        if reply is None:
+            raise TimeoutError("no reply to macro command")
+        return reply
+
     def close(self) -> None:
         if self._auto_thread:
             self._stop_event.set()
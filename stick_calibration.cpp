@@ -0,0 +1,175 @@
+#include "stick_calibration.h"
+
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+#include "pico/platform.h"
+#include "spi_flash_store.h"
+#include "switch_pro_descriptors.h"
+
+#ifdef SWITCH_PICO_LOG
+#define LOG_PRINTF(...) printf(__VA_ARGS__)
+#else
+#define LOG_PRINTF(...) ((void)0)
+#endif
+
+#define CALIBRATION_REST_WINDOW 0x100  // distance from the centre estimate that still counts as resting
+#define CALIBRATION_CENTRE_SHIFT 3     // each resting sample moves the centre 1/8 of the way
+#define CALIBRATION_MIN_SPAN 0x200     // shortest centre-to-edge distance worth saving
+
+typedef struct {
+    uint16_t min;
+    uint16_t max;
+    int32_t centre_q4;  // 4 fractional bits, so small steps still move it
+} AxisTracker;
+
+typedef struct {
+    AxisTracker x;
+    AxisTracker y;
+    bool seeded;
+} StickTracker;
+
+static StickTracker g_trackers[2];
+static bool g_learning = false;
+
+void stick_calibration_learn() {
+    memset(g_trackers, 0, sizeof(g_trackers));
+    g_learning = true;
+    LOG_PRINTF("[CAL] learning stick ranges\n");
+}
+
+void stick_calibration_stop() {
+    g_learning = false;
+}
+
+bool stick_calibration_learning() {
+    return g_learning;
+}
+
+static StickAxisRange axis_range(const AxisTracker& tracker) {
+    return StickAxisRange{tracker.min, static_cast<uint16_t>(tracker.centre_q4 >> 4), tracker.max};
+}
+
+void stick_calibration_observed(uint8_t stick, StickRange* out) {
+    const StickTracker& tracker = g_trackers[stick];
+    if (!tracker.seeded) {
+        *out = StickRange{};
+        return;
+    }
+    out->x = axis_range(tracker.x);
+    out->y = axis_range(tracker.y);
+}
+
+static bool axis_wide_enough(const StickAxisRange& range) {
+    return range.centre >= range.min + CALIBRATION_MIN_SPAN && range.max >= range.centre + CALIBRATION_MIN_SPAN;
+}
+
+// One x/y pair in the packed 12-bit layout of SwitchLeftCalibration/SwitchRightCalibration.
+static void pack_pair(uint8_t* out, uint16_t x, uint16_t y) {
+    out[0] = static_cast<uint8_t>(x & 0xFF);
+    out[1] = static_cast<uint8_t>(((x >> 8) & 0x0F) | ((y & 0x0F) << 4));
+    out[2] = static_cast<uint8_t>(y >> 4);
+}
+
+// Magic plus calibration block for one stick. The left stick stores the
+// distance above centre, the centre and the distance below it; the right
+// stick stores the centre first.
+static void encode_stick(uint8_t stick, const StickRange& range, uint8_t out[2 + sizeof(SwitchLeftCalibration)]) {
+    out[0] = SWITCH_USER_CALIBRATION_MAGIC_0;
+    out[1] = SWITCH_USER_CALIBRATION_MAGIC_1;
+    uint8_t* data = &out[2];
+    uint16_t above_x = static_cast<uint16_t>(range.x.max - range.x.centre);
+    uint16_t above_y = static_cast<uint16_t>(range.y.max - range.y.centre);
+    uint16_t below_x = static_cast<uint16_t>(range.x.centre - range.x.min);
+    uint16_t below_y = static_cast<uint16_t>(range.y.centre - range.y.min);
+    if (stick == 0) {
+        pack_pair(&data[0], above_x, above_y);
+        pack_pair(&data[3], range.x.centre, range.y.centre);
+        pack_pair(&data[6], below_x, below_y);
+    } else {
+        pack_pair(&data[0], range.x.centre, range.y.centre);
+        pack_pair(&data[3], below_x, below_y);
+        pack_pair(&data[6], above_x, above_y);
+    }
+}
+
+static uint32_t stick_block_address(uint8_t stick) {
+    return SWITCH_USER_CALIBRATION_ADDRESS + (stick == 0 ? offsetof(SwitchUserCalibration, leftCalibrationMagic)
+                                                         : offsetof(SwitchUserCalibration, rightCalibrationMagic));
+}
+
+StickCalibrationResult stick_calibration_save(uint8_t* saved) {
+    g_learning = false;
+    *saved = 0;
+    for (uint8_t stick = 0; stick < 2; ++stick) {
+        StickRange range;
+        stick_calibration_observed(stick, &range);
+        if (!g_trackers[stick].seeded || !axis_wide_enough(range.x) || !axis_wide_enough(range.y)) {
+            continue;
+        }
+        uint8_t block[2 + sizeof(SwitchLeftCalibration)];
+        encode_stick(stick, range, block);
+        if (!spi_flash_store_write(stick_block_address(stick), block, sizeof(block))) {
+            switch_pro_reload_stick_calibration();
+            return STICK_CALIBRATION_ERR_STORE;
+        }
+        *saved = static_cast<uint8_t>(*saved | (1u << stick));
+        LOG_PRINTF("[CAL] stick %u x %u/%u/%u y %u/%u/%u\n", stick, range.x.min, range.x.centre, range.x.max,
+                   range.y.min, range.y.centre, range.y.max);
+    }
+    if (!*saved) {
+        return STICK_CALIBRATION_ERR_RANGE;
+    }
+    switch_pro_reload_stick_calibration();
+    return STICK_CALIBRATION_OK;
+}
+
+StickCalibrationResult stick_calibration_clear() {
+    uint8_t erased[2 * (2 + sizeof(SwitchLeftCalibration))];
+    memset(erased, 0xFF, sizeof(erased));
+    bool stored = spi_flash_store_write(stick_block_address(0), erased, sizeof(erased));
+    switch_pro_reload_stick_calibration();
+    return stored ? STICK_CALIBRATION_OK : STICK_CALIBRATION_ERR_STORE;
+}
+
+static void __not_in_flash_func(observe_axis)(AxisTracker* tracker, uint16_t value) {
+    if (value < tracker->min) {
+        tracker->min = value;
+    }
+    if (value > tracker->max) {
+        tracker->max = value;
+    }
+}
+
+static bool __not_in_flash_func(near_centre)(const AxisTracker& tracker, uint16_t value) {
+    int32_t distance = static_cast<int32_t>(value) - (tracker.centre_q4 >> 4);
+    return distance > -CALIBRATION_REST_WINDOW && distance < CALIBRATION_REST_WINDOW;
+}
+
+static void __not_in_flash_func(observe_stick)(StickTracker* tracker, uint16_t x, uint16_t y) {
+    if (!tracker->seeded) {
+        tracker->x = AxisTracker{x, x, static_cast<int32_t>(x) << 4};
+        tracker->y = AxisTracker{y, y, static_cast<int32_t>(y) << 4};
+        tracker->seeded = true;
+        return;
+    }
+    observe_axis(&tracker->x, x);
+    observe_axis(&tracker->y, y);
+    if (near_centre(tracker->x, x) && near_centre(tracker->y, y)) {
+        tracker->x.centre_q4 += ((static_cast<int32_t>(x) << 4) - tracker->x.centre_q4) >> CALIBRATION_CENTRE_SHIFT;
+        tracker->y.centre_q4 += ((static_cast<int32_t>(y) << 4) - tracker->y.centre_q4) >> CALIBRATION_CENTRE_SHIFT;
+    }
+}
+
+void __not_in_flash_func(stick_calibration_apply)(const SwitchInputState* state, bool new_report) {
+    if (!g_learning || !new_report) {
+        return;
+    }
+    // The report's 12-bit range tops out at 0xFFF; full host deflection on Y mirrors to 4096.
+    auto report_y = [](uint16_t value) -> uint16_t {
+        uint16_t y = switch_stick_report_y(value);
+        return y > 0xFFF ? 0xFFF : y;
+    };
+    observe_stick(&g_trackers[0], switch_stick_report_x(state->lx), report_y(state->ly));
+    observe_stick(&g_trackers[1], switch_stick_report_x(state->rx), report_y(state->ry));
+}
@@ -0,0 +1,63 @@
+/*
+ * Learns a host pad's real stick range and stores it as the controller's
+ * user stick calibration, the block the console's own "Calibrate Control
+ * Sticks" screen writes. Pads whose range differs from the emulated one then
+ * reach full deflection exactly at their physical limit instead of clipping
+ * early or falling short.
+ *
+ * While learning, every report updates a running minimum and maximum per
+ * axis, and the centre follows an average of the samples taken while the
+ * stick rests near it. Values are in input report units (see
+ * switch_stick_report_x/y), observed after stick shaping.
+ *
+ * Saving writes the SPI user calibration through spi_flash_store, so it is
+ * persisted like any console write, and the driver clamps to it at once. The
+ * console reads calibration when it connects, so it applies from the next
+ * connection.
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "switch_pro_driver.h"
+
+typedef struct {
+    uint16_t min;
+    uint16_t centre;
+    uint16_t max;
+} StickAxisRange;
+
+typedef struct {
+    StickAxisRange x;
+    StickAxisRange y;
+} StickRange;
+
+typedef enum {
+    STICK_CALIBRATION_OK = 0,
+    STICK_CALIBRATION_ERR_INVALID = 1,  // malformed command
+    STICK_CALIBRATION_ERR_RANGE = 2,    // no stick moved far enough to save
+    STICK_CALIBRATION_ERR_STORE = 3,    // the SPI write failed
+} StickCalibrationResult;
+
+// Forget what was observed and start learning from the next report. Leave the
+// sticks at rest when starting: the first sample seeds the centre.
+void stick_calibration_learn();
+
+// Stop learning, keeping what was observed.
+void stick_calibration_stop();
+
+bool stick_calibration_learning();
+
+// Observed range of a stick (0 left, 1 right).
+void stick_calibration_observed(uint8_t stick, StickRange* out);
+
+// Stop learning and store each stick whose observed range is wide enough.
+// *saved gets a bit per stick stored.
+StickCalibrationResult stick_calibration_save(uint8_t* saved);
+
+// Remove the user calibration so the console and clamp use the factory one.
+StickCalibrationResult stick_calibration_clear();
+
+// Report filter stage; only observes.
+void stick_calibration_apply(const SwitchInputState* state, bool new_report);
@@ -0,0 +1,143 @@
+#include "stick_shaping.h"
+
+#if defined(PICO_ON_DEVICE) && PICO_ON_DEVICE
+#include "pico/platform.h"
+#else
+#define __not_in_flash_func(name) name
+#endif
+
+#define Q16_ONE 65536u
+#define Q15_ONE 32768
+
+static uint32_t percent_to_q16(uint8_t percent) {
+    return static_cast<uint32_t>(percent) * Q16_ONE / 100u;
+}
+
+bool stick_shape_config_valid(const StickShapeConfig& config) {
+    const uint8_t known_flags = STICK_SHAPE_RADIAL | STICK_SHAPE_CIRCLE;
+    if ((config.flags & ~known_flags) || ((config.flags & STICK_SHAPE_CIRCLE) && !(config.flags & STICK_SHAPE_RADIAL))) {
+        return false;
+    }
+    return config.saturation <= 100 && config.deadzone < config.saturation && config.anti_deadzone < 100 &&
+           config.expo <= 100;
+}
+
+uint32_t stick_shape_magnitude(const StickShapeConfig& config, uint32_t magnitude_q16) {
+    uint32_t deadzone = percent_to_q16(config.deadzone);
+    uint32_t saturation = percent_to_q16(config.saturation);
+    if (magnitude_q16 <= deadzone) {
+        return 0;
+    }
+    // Position between the deadzone edge and the saturation point.
+    uint32_t t = magnitude_q16 >= saturation
+                     ? Q16_ONE
+                     : static_cast<uint32_t>((static_cast<uint64_t>(magnitude_q16 - deadzone) << 16) /
+                                             (saturation - deadzone));
+    uint32_t cube = static_cast<uint32_t>((static_cast<uint64_t>(t) * t >> 16) * t >> 16);
+    uint32_t curved = (t * (100u - config.expo) + cube * config.expo) / 100u;
+    uint32_t anti = percent_to_q16(config.anti_deadzone);
+    return anti + static_cast<uint32_t>(static_cast<uint64_t>(Q16_ONE - anti) * curved >> 16);
+}
+
+void stick_shaper_build(StickShaper* shaper, const StickShapeConfig& config) {
+    const StickShapeConfig defaults = STICK_SHAPE_DEFAULT;
+    shaper->identity = config.deadzone == defaults.deadzone && config.anti_deadzone == defaults.anti_deadzone &&
+                       config.saturation == defaults.saturation && config.expo == defaults.expo &&
+                       config.flags == defaults.flags;
+    shaper->flags = config.flags;
+    // Steps inside the deadzone hold the value just outside it, so the step
+    // straddling the edge interpolates from the anti-deadzone level, not 0.
+    uint32_t deadzone = percent_to_q16(config.deadzone);
+    shaper->deadzone = static_cast<uint16_t>(deadzone >> 1);
+    for (uint32_t step = 0; step <= STICK_MAGNITUDE_STEPS; ++step) {
+        uint32_t magnitude = step * 256 > deadzone ? step * 256 : deadzone + 1;
+        shaper->magnitude[step] = static_cast<uint16_t>(stick_shape_magnitude(config, magnitude) >> 1);
+    }
+}
+
+uint32_t stick_isqrt32(uint32_t value) {
+    uint32_t root = 0;
+    uint32_t bit = 1u << 30;
+    while (bit > value) {
+        bit >>= 2;
+    }
+    while (bit) {
+        if (value >= root + bit) {
+            value -= root + bit;
+            root = (root >> 1) + bit;
+        } else {
+            root >>= 1;
+        }
+        bit >>= 2;
+    }
+    return root;
+}
+
+static uint16_t to_axis(int32_t offset) {
+    int32_t value = Q15_ONE + offset;
+    return static_cast<uint16_t>(value < 0 ? 0 : value > 0xFFFF ? 0xFFFF : value);
+}
+
+// Shaped Q15 distance, interpolated between table steps so the output keeps
+// 16-bit resolution. distance must be past the deadzone and at most Q15_ONE.
+static int32_t __not_in_flash_func(shape_distance)(const StickShaper& shaper, uint32_t distance) {
+    uint32_t step = distance >> 7;
+    int32_t shaped = shaper.magnitude[step];
+    if (step < STICK_MAGNITUDE_STEPS) {
+        shaped += (static_cast<int32_t>(shaper.magnitude[step + 1]) - shaped) * static_cast<int32_t>(distance & 127) >> 7;
+    }
+    return shaped;
+}
+
+// The axis range is lopsided around 0x8000: 0x8000 steps down, 0x7FFF up.
+static uint16_t __not_in_flash_func(shape_axis)(const StickShaper& shaper, uint16_t value) {
+    if (value < Q15_ONE) {
+        uint32_t distance = Q15_ONE - value;
+        return distance <= shaper.deadzone ? Q15_ONE : to_axis(-shape_distance(shaper, distance));
+    }
+    uint32_t distance = value - Q15_ONE;
+    distance += distance == 0x7FFF;  // 0xFFFF is full deflection
+    if (distance <= shaper.deadzone) {
+        return Q15_ONE;
+    }
+    int32_t shaped = shape_distance(shaper, distance);
+    return to_axis(shaped > 0x7FFF ? 0x7FFF : shaped);
+}
+
+void __not_in_flash_func(stick_shaper_apply)(const StickShaper& shaper, uint16_t* x, uint16_t* y) {
+    if (shaper.identity) {
+        return;
+    }
+    if (!(shaper.flags & STICK_SHAPE_RADIAL)) {
+        *x = shape_axis(shaper, *x);
+        *y = shape_axis(shaper, *y);
+        return;
+    }
+
+    int32_t dx = static_cast<int32_t>(*x) - Q15_ONE;
+    int32_t dy = static_cast<int32_t>(*y) - Q15_ONE;
+    uint32_t length = stick_isqrt32(static_cast<uint32_t>(dx * dx) + static_cast<uint32_t>(dy * dy));
+    if (length == 0) {
+        *x = *y = Q15_ONE;
+        return;
+    }
+    // Square gates reach full deflection along their edge, where the larger
+    // component is maxed out; the shaped length then maps them onto a circle.
+    uint32_t deflection = length;
+    if (shaper.flags & STICK_SHAPE_CIRCLE) {
+        uint32_t ax = static_cast<uint32_t>(dx < 0 ? -dx : dx);
+        uint32_t ay = static_cast<uint32_t>(dy < 0 ? -dy : dy);
+        deflection = ax > ay ? ax : ay;
+    }
+    if (deflection > Q15_ONE) {
+        deflection = Q15_ONE;
+    }
+    if (deflection <= shaper.deadzone) {
+        *x = *y = Q15_ONE;
+        return;
+    }
+
+    int32_t shaped = shape_distance(shaper, deflection);
+    *x = to_axis(dx * shaped / static_cast<int32_t>(length));
+    *y = to_axis(dy * shaped / static_cast<int32_t>(length));
+}
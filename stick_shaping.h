@@ -0,0 +1,50 @@
+/*
+ * Stick response shaping: deadzone, anti-deadzone, outer saturation and an
+ * expo curve, baked into a table whenever the settings change so that shaping
+ * a report costs an interpolated lookup per axis (or per stick in radial
+ * mode). Plain C++
+ * with no SDK dependencies, so it also builds on the host; see
+ * tools/bench_stick_shaping.cpp.
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define STICK_SHAPE_RADIAL 0x01  // shape the vector's length, keeping its direction (no diagonal snapping)
+#define STICK_SHAPE_CIRCLE 0x02  // radial only: treat a square gate's edge as full deflection
+
+// Deadzone, anti-deadzone, saturation and expo are percent of full deflection.
+typedef struct {
+    uint8_t deadzone;       // ignored around the centre
+    uint8_t anti_deadzone;  // output jumps to this on leaving the deadzone
+    uint8_t saturation;     // deflection that already counts as full; 100 = none
+    uint8_t expo;           // blend from linear (0) to cubic (100): finer control near the centre
+    uint8_t flags;          // STICK_SHAPE_*
+} StickShapeConfig;
+
+#define STICK_SHAPE_DEFAULT {0, 0, 100, 0, 0}
+
+#define STICK_MAGNITUDE_STEPS 256
+
+typedef struct {
+    bool identity;  // default settings: leave input untouched
+    uint8_t flags;
+    uint16_t deadzone;                              // Q15 distance from centre (radial: length) treated as centred
+    uint16_t magnitude[STICK_MAGNITUDE_STEPS + 1];  // Q15 distance in steps of 128 -> shaped Q15 distance
+} StickShaper;
+
+bool stick_shape_config_valid(const StickShapeConfig& config);
+
+// Response to a deflection magnitude, both Q16 (65536 = full).
+uint32_t stick_shape_magnitude(const StickShapeConfig& config, uint32_t magnitude_q16);
+
+// Rebuild the tables; the config must be valid.
+void stick_shaper_build(StickShaper* shaper, const StickShapeConfig& config);
+
+// Floor of the square root, bit by bit (no multiplies or divides).
+uint32_t stick_isqrt32(uint32_t value);
+
+// Shape one stick's 16-bit axis values (0x8000 = centre) in place.
+void stick_shaper_apply(const StickShaper& shaper, uint16_t* x, uint16_t* y);
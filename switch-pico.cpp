@@ -1,10 +1,38 @@
 #include <stdio.h>
 #include <string.h>
 #include "bsp/board.h"
+#include "hardware/irq.h"
+#include "hardware/structs/scb.h"
+#include "hardware/sync.h"
 #include "hardware/uart.h"
+#include "pico/multicore.h"
 #include "pico/stdlib.h"
 #include "tusb.h"
+#include "pico/flash.h"
+#include "device_identity.h"
+#include "input_merge.h"
+#include "input_recorder.h"
+#include "macro_library.h"
+#include "macro_player.h"
+#include "seqlock_snapshot.h"
+#include "socd.h"
+#include "spsc_queue.h"
+#include "spi_flash_store.h"
+#include "stick_calibration.h"
+#include "stick_shaping.h"
 #include "switch_pro_driver.h"
+#include "switch_rumble.h"
+#include "turbo.h"
+#include "uart_protocol.h"
+#ifdef SWITCH_PICO_PIO_RX
+#include "pio_serial_rx.h"
+#endif
+#ifdef SWITCH_PICO_GPIO_BUTTONS
+#include "gpio_buttons.h"
+#endif
+#ifdef SWITCH_PICO_BENCH
+#include "switch_pico_bench.h"
+#endif
 
 #ifdef SWITCH_PICO_LOG
 #define LOG_PRINTF(...) printf(__VA_ARGS__)
@@ -14,23 +42,133 @@
 
 // UART1 is reserved for external input frames from the host PC.
 #define UART_ID uart1
+#define UART_IRQ_ID UART1_IRQ
 #define BAUD_RATE 921600
 #define UART_TX_PIN 4
 #define UART_RX_PIN 5
-#define UART_RUMBLE_HEADER 0xBB
-#define UART_RUMBLE_RUMBLE_TYPE 0x01
+#define UART_TX_RING_SIZE 256 // power of two
+
+// Rumble forwarding: at most one frame per interval (newest payload wins), and
+// an unchanged non-idle payload is re-sent periodically so the host's
+// RUMBLE_IDLE_TIMEOUT (250 ms) does not switch the motors off.
+#define RUMBLE_FORWARD_MIN_INTERVAL_US 10000
+#define RUMBLE_REFRESH_INTERVAL_US 100000
+
+// The PIO link's DMA ring raises no interrupt, so core 1 wakes this often to check it.
+#define PIO_RX_POLL_INTERVAL_US 100
 
 static bool g_last_mounted = false;
 static bool g_last_ready = false;
 
-// Track the latest state provided by UART or the autopilot.
+// Outgoing UART1 bytes. USB callbacks produce into the ring and return
+// immediately; the UART1 TX interrupt consumes it into the hardware FIFO.
+static uint8_t g_tx_ring[UART_TX_RING_SIZE];
+static volatile uint16_t g_tx_head = 0; // written by the producer only
+static volatile uint16_t g_tx_tail = 0; // written by the consumer only
+static uint32_t g_tx_dropped_frames = 0;
+
+static SwitchRumbleBands g_rumble_pending{};
+static uint32_t g_rumble_pending_arrival_us = 0;
+static bool g_rumble_pending_valid = false;
+static SwitchRumbleBands g_rumble_sent{};
+static uint32_t g_rumble_sent_arrival_us = 0;
+static bool g_rumble_sent_valid = false;
+static uint32_t g_rumble_last_sent_us = 0;
+
+// Merged input from every source, as last passed to the driver (core 0 only).
 static SwitchInputState g_user_state;
 
+// Core 1 publishes each serial link's parsed state here, indexed by its
+// InputSlot (UART1, PIO); core 0 takes the newest of each into the merge.
+#define SERIAL_INPUT_LINKS 2
+static SeqlockSnapshot<SwitchInputState> g_serial_input[SERIAL_INPUT_LINKS];
+static_assert(INPUT_SLOT_UART == 0 && INPUT_SLOT_PIO == 1, "serial links index g_serial_input by slot");
+
+// Hosts resend their state continuously (the bridge at 500 Hz), so a link
+// silent this long has gone away; its held input is dropped from the merge.
+#define SERIAL_INPUT_TIMEOUT_US 500000
+static absolute_time_t g_serial_input_expiry[SERIAL_INPUT_LINKS];
+
+// Validated non-input frames, handed from core 1 to core 0 in order. Config
+// changes are rare, so a full queue simply drops the frame; the host retries
+// when it gets no reply.
+typedef struct {
+    uint8_t length;
+    uint8_t data[UART_FRAME_MAX_LENGTH];
+} ConfigFrame;
+
+static SpscQueue<ConfigFrame, 4> g_config_frames;
+
+// Host stick response, rebuilt by core 0 when the host changes the settings.
+static StickShaper g_stick_shapers[2];  // left, right
+
+// Move queued bytes into the TX FIFO. Only ever runs from the UART1 IRQ or
+// with that IRQ masked, so there is a single consumer at any time.
+static void __not_in_flash_func(uart_tx_drain)() {
+    uart_hw_t* hw = uart_get_hw(UART_ID);
+    uint16_t head = g_tx_head;
+    uint16_t tail = g_tx_tail;
+    __dmb();
+    while (tail != head && uart_is_writable(UART_ID)) {
+        hw->dr = g_tx_ring[tail & (UART_TX_RING_SIZE - 1)];
+        tail++;
+    }
+    g_tx_tail = tail;
+    // The PL011 TX interrupt fires on the FIFO crossing its trigger level, so
+    // it is only armed while bytes remain queued behind a non-empty FIFO.
+    if (tail == head) {
+        hw_clear_bits(&hw->imsc, UART_UARTIMSC_TXIM_BITS);
+    } else {
+        hw_set_bits(&hw->imsc, UART_UARTIMSC_TXIM_BITS);
+    }
+}
+
+#define UART_RX_WAKE_BITS (UART_UARTIMSC_RXIM_BITS | UART_UARTIMSC_RTIM_BITS)
+
+// RX data is drained by core 1, not here: mask the (level) RX interrupts and
+// wake core 1, which re-arms them once the FIFO is empty.
+static void __not_in_flash_func(on_uart_irq)() {
+    uart_hw_t* hw = uart_get_hw(UART_ID);
+    if (hw->mis & (UART_UARTMIS_RXMIS_BITS | UART_UARTMIS_RTMIS_BITS)) {
+        hw_clear_bits(&hw->imsc, UART_RX_WAKE_BITS);
+        __sev();
+    }
+    uart_tx_drain();
+}
+
+// Queue a complete frame for transmission; drops the frame if the ring is full.
+static bool uart_tx_enqueue(const uint8_t* data, uint16_t length) {
+    uint16_t head = g_tx_head;
+    uint16_t used = static_cast<uint16_t>(head - g_tx_tail);
+    if (UART_TX_RING_SIZE - used < length) {
+        g_tx_dropped_frames++;
+        LOG_PRINTF("[UART] tx ring full, dropped frame (%lu total)\n", (unsigned long)g_tx_dropped_frames);
+        return false;
+    }
+    for (uint16_t i = 0; i < length; ++i) {
+        g_tx_ring[(head + i) & (UART_TX_RING_SIZE - 1)] = data[i];
+    }
+    __dmb();
+    g_tx_head = static_cast<uint16_t>(head + length);
+
+    // Prime the FIFO directly; the interrupt takes over if anything is left.
+    irq_set_enabled(UART_IRQ_ID, false);
+    uart_tx_drain();
+    irq_set_enabled(UART_IRQ_ID, true);
+    return true;
+}
+
 static void init_uart_input() {
     uart_init(UART_ID, BAUD_RATE);
     gpio_set_function(UART_TX_PIN, GPIO_FUNC_UART);
     gpio_set_function(UART_RX_PIN, GPIO_FUNC_UART);
     uart_set_format(UART_ID, 8, 1, UART_PARITY_NONE);
+    // Raise the RX interrupt at 1/8 full (4 bytes) rather than the default
+    // half: input frames are 12 + 12n bytes, so their last byte wakes core 1
+    // at once instead of waiting out the 32-bit-time RX timeout (~35 us).
+    hw_write_masked(&uart_get_hw(UART_ID)->ifls, 0u << UART_UARTIFLS_RXIFLSEL_LSB, UART_UARTIFLS_RXIFLSEL_BITS);
+    irq_set_exclusive_handler(UART_IRQ_ID, on_uart_irq);
+    irq_set_enabled(UART_IRQ_ID, true);
 }
 
 static SwitchInputState neutral_input() {
@@ -42,99 +180,683 @@ static SwitchInputState neutral_input() {
     return state;
 }
 
-static void send_rumble_uart_frame(const uint8_t rumble[8]) {
-    uint8_t frame[11];
+// Pico -> host frame: header, type, payload, checksum (length implied by type).
+static bool send_uart_frame(uint8_t type, const uint8_t* payload, uint8_t length) {
+    uint8_t frame[UART_FRAME_MAX_LENGTH];
+    if (length + 3u > sizeof(frame)) {
+        return false;
+    }
     frame[0] = UART_RUMBLE_HEADER;
-    frame[1] = UART_RUMBLE_RUMBLE_TYPE;
-    memcpy(&frame[2], rumble, 8);
-
+    frame[1] = type;
+    memcpy(&frame[2], payload, length);
     uint8_t checksum = 0;
-    for (int i = 0; i < 10; ++i) {
+    for (uint8_t i = 0; i < length + 2u; ++i) {
         checksum = static_cast<uint8_t>(checksum + frame[i]);
     }
-    frame[10] = checksum;
-    uart_write_blocking(UART_ID, frame, sizeof(frame));
+    frame[length + 2] = checksum;
+    return uart_tx_enqueue(frame, static_cast<uint16_t>(length + 3u));
+}
+
+// Frames carry the time the USB OUT report reached the rumble callback and how
+// long it waited before being queued, so the host can measure haptic latency.
+static void send_rumble_uart_frame(const SwitchRumbleBands& bands, uint32_t arrival_us, uint32_t now_us) {
+    uint32_t dwell = now_us - arrival_us;
+    uint16_t dwell_us = dwell > 0xFFFF ? 0xFFFF : static_cast<uint16_t>(dwell);
+
+    uint8_t payload[10];
+    payload[0] = bands.low_amp;
+    payload[1] = bands.low_freq;
+    payload[2] = bands.high_amp;
+    payload[3] = bands.high_freq;
+    payload[4] = static_cast<uint8_t>(arrival_us & 0xFF);
+    payload[5] = static_cast<uint8_t>((arrival_us >> 8) & 0xFF);
+    payload[6] = static_cast<uint8_t>((arrival_us >> 16) & 0xFF);
+    payload[7] = static_cast<uint8_t>((arrival_us >> 24) & 0xFF);
+    payload[8] = static_cast<uint8_t>(dwell_us & 0xFF);
+    payload[9] = static_cast<uint8_t>((dwell_us >> 8) & 0xFF);
+    send_uart_frame(UART_RUMBLE_TIMED_TYPE, payload, sizeof(payload));
+}
+
+static bool same_rumble(const SwitchRumbleBands& a, const SwitchRumbleBands& b) {
+    return a.low_amp == b.low_amp && a.low_freq == b.low_freq &&
+           a.high_amp == b.high_amp && a.high_freq == b.high_freq;
 }
 
 static void on_rumble_from_switch(const uint8_t rumble[8]) {
-    send_rumble_uart_frame(rumble);
+    // Decode once here; coalesced in service_rumble() so only the newest payload is kept.
+    switch_rumble_decode(rumble, &g_rumble_pending);
+    g_rumble_pending_arrival_us = time_us_32();
+    g_rumble_pending_valid = true;
 }
 
-// Consume UART bytes and forward complete frames to the Switch Pro driver.
-static bool poll_uart_frames() {
-    static uint8_t buffer[64];
-    static uint8_t index = 0;
-    static uint8_t expected_len = 0;
-    static absolute_time_t last_byte_time = {0};
-    static bool has_last_byte = false;
-    bool new_data = false;
+static void forward_rumble(const SwitchRumbleBands& bands, uint32_t arrival_us, uint32_t now_us) {
+    send_rumble_uart_frame(bands, arrival_us, now_us);
+    g_rumble_sent = bands;
+    g_rumble_sent_arrival_us = arrival_us;
+    g_rumble_sent_valid = true;
+    g_rumble_last_sent_us = now_us;
+}
+
+// Forward rumble only when the payload changes, capped to one frame per
+// RUMBLE_FORWARD_MIN_INTERVAL_US, plus a periodic refresh of active rumble.
+static void service_rumble() {
+    uint32_t now = time_us_32();
+    uint32_t since_sent = now - g_rumble_last_sent_us;
+
+    if (g_rumble_pending_valid) {
+        if (g_rumble_sent_valid && same_rumble(g_rumble_pending, g_rumble_sent)) {
+            g_rumble_pending_valid = false;
+        } else if (!g_rumble_sent_valid || since_sent >= RUMBLE_FORWARD_MIN_INTERVAL_US) {
+            forward_rumble(g_rumble_pending, g_rumble_pending_arrival_us, now);
+            g_rumble_pending_valid = false;
+            return;
+        } else {
+            return; // rate capped; a newer payload may still replace this one
+        }
+    }
+
+    if (g_rumble_sent_valid && !switch_rumble_is_idle(g_rumble_sent) && since_sent >= RUMBLE_REFRESH_INTERVAL_US) {
+        // Refreshes repeat the original arrival time so the host can ignore them.
+        forward_rumble(g_rumble_sent, g_rumble_sent_arrival_us, now);
+    }
+}
+
+// When service_rumble() next has timed work: a rate-capped pending payload or
+// the periodic refresh of an active one.
+static absolute_time_t next_rumble_service_time() {
+    uint32_t interval;
+    if (g_rumble_pending_valid) {
+        interval = RUMBLE_FORWARD_MIN_INTERVAL_US;
+    } else if (g_rumble_sent_valid && !switch_rumble_is_idle(g_rumble_sent)) {
+        interval = RUMBLE_REFRESH_INTERVAL_US;
+    } else {
+        return at_the_end_of_time;
+    }
+    uint32_t since_sent = time_us_32() - g_rumble_last_sent_us;
+    return make_timeout_time_us(since_sent >= interval ? 0 : interval - since_sent);
+}
+
+// Byte-at-a-time frame sync shared by every serial input source.
+typedef struct {
+    uint8_t buffer[UART_FRAME_MAX_LENGTH];
+    uint8_t index;
+    uint8_t expected_len;
+    uint32_t last_byte_ms;
+    bool has_last_byte;
+} InputFrameParser;
 
+static InputFrameParser g_uart_parser{};
+#ifdef SWITCH_PICO_PIO_RX
+static InputFrameParser g_pio_parser{};
+#endif
+
+static void log_input_packet(const char* source, const SwitchInputState& parsed) {
+    (void)source;
+    (void)parsed;
+    LOG_PRINTF("[%s] packet buttons=0x%04x hat=%u lx=%u ly=%u rx=%u ry=%u\n", source,
+               switch_input_buttons(parsed), switch_input_hat(parsed),
+               parsed.lx >> 8, parsed.ly >> 8, parsed.rx >> 8, parsed.ry >> 8);
+}
+
+// Feed one received byte. When it completes a frame with a valid checksum,
+// returns the frame length; the frame stays in p->buffer until the next call.
+static uint8_t __not_in_flash_func(input_frame_parser_feed)(InputFrameParser* p, uint8_t byte, uint32_t now_ms) {
+    if (p->expected_len != 0 && p->index >= p->expected_len) {
+        p->index = 0; // previous call returned a complete frame
+        p->expected_len = 0;
+    }
+    if (p->has_last_byte && (now_ms - p->last_byte_ms) > 20) {
+        p->index = 0; // stale data, restart frame
+        p->expected_len = 0;
+    }
+    p->last_byte_ms = now_ms;
+    p->has_last_byte = true;
+
+    if (p->index == 0) {
+        if (byte != UART_FRAME_HEADER) {
+            return 0; // wait for start-of-frame marker
+        }
+    }
+
+    if (p->index >= sizeof(p->buffer)) {
+        p->index = 0;
+        p->expected_len = 0;
+    }
+
+    p->buffer[p->index++] = byte;
+    if (p->index == 3) {
+        p->expected_len = static_cast<uint8_t>(p->buffer[2] + 4u);
+        if (p->expected_len > sizeof(p->buffer)) {
+            p->index = 0;
+            p->expected_len = 0;
+            return 0;
+        }
+    }
+
+    if (p->expected_len == 0 || p->index < p->expected_len) {
+        return 0;
+    }
+    uint8_t checksum = 0;
+    for (uint8_t i = 0; i + 1 < p->expected_len; ++i) {
+        checksum = static_cast<uint8_t>(checksum + p->buffer[i]);
+    }
+    if (checksum != p->buffer[p->expected_len - 1]) {
+        p->index = 0;
+        p->expected_len = 0;
+        return 0;
+    }
+    return p->expected_len;
+}
+
+// Route one complete frame: input goes to the snapshot, anything else to core 0.
+// Returns true if it published new input.
+static bool __not_in_flash_func(handle_serial_frame)(const char* source, InputSlot slot, const uint8_t* frame,
+                                                      uint8_t length) {
+    if (frame[1] == UART_FRAME_INPUT) {
+        SwitchInputState parsed{};
+        if (!switch_pro_apply_uart_packet(frame, length, &parsed)) {
+            return false;
+        }
+        g_serial_input[slot].write(parsed);
+        log_input_packet(source, parsed);
+        return true;
+    }
+    ConfigFrame config;
+    config.length = length;
+    memcpy(config.data, frame, length);
+    if (!g_config_frames.push(config)) {
+        LOG_PRINTF("[%s] config queue full, dropped frame type 0x%02x\n", source, frame[1]);
+    }
+    return false;
+}
+
+// Consume UART bytes and publish complete, validated frames to core 0.
+static bool __not_in_flash_func(poll_uart_frames)() {
+    bool new_data = false;
     while (uart_is_readable(UART_ID)) {
         uint8_t byte = uart_getc(UART_ID);
-
-        uint64_t now = to_ms_since_boot(get_absolute_time());
-        if (has_last_byte && (now - to_ms_since_boot(last_byte_time)) > 20) {
-            index = 0; // stale data, restart frame
-            expected_len = 0;
+        uint8_t length = input_frame_parser_feed(&g_uart_parser, byte, to_ms_since_boot(get_absolute_time()));
+        if (length) {
+            new_data |= handle_serial_frame("UART", INPUT_SLOT_UART, g_uart_parser.buffer, length);
         }
-        last_byte_time = get_absolute_time();
-        has_last_byte = true;
+    }
+    return new_data;
+}
 
-        if (index == 0) {
-            if (byte != 0xAA) {
-                continue; // wait for start-of-frame marker
+#ifdef SWITCH_PICO_PIO_RX
+// Drain the PIO link's DMA ring through its own parser. It feeds its own merge
+// slot, so a second host (a co-pilot) can play alongside the one on UART1.
+static bool __not_in_flash_func(poll_pio_frames)() {
+    uint8_t chunk[64];
+    bool new_data = false;
+    size_t count;
+    while ((count = pio_serial_rx_read(chunk, sizeof(chunk))) > 0) {
+        uint32_t now_ms = to_ms_since_boot(get_absolute_time());
+        for (size_t i = 0; i < count; ++i) {
+            uint8_t length = input_frame_parser_feed(&g_pio_parser, chunk[i], now_ms);
+            if (length) {
+                new_data |= handle_serial_frame("PIO", INPUT_SLOT_PIO, g_pio_parser.buffer, length);
             }
         }
+    }
+    return new_data;
+}
+#endif
 
-        if (index >= sizeof(buffer)) {
-            index = 0;
-            expected_len = 0;
+// Reply with the identity the next boot will use, or flag a rejected update.
+static void send_identity_reply(bool rejected) {
+    uint8_t payload[1 + sizeof(DeviceIdentity)];
+    DeviceIdentity identity;
+    DeviceIdentityStatus status = device_identity_current(&identity);
+    payload[0] = static_cast<uint8_t>(rejected ? DEVICE_IDENTITY_REJECTED : status);
+    memcpy(&payload[1], &identity, sizeof(identity));
+    send_uart_frame(UART_REPLY_IDENTITY, payload, sizeof(payload));
+}
+
+static void send_macro_reply(MacroResult result) {
+    uint16_t pc = macro_player_pc();
+    uint8_t payload[5] = {
+        static_cast<uint8_t>(result),
+        static_cast<uint8_t>(macro_player_state()),
+        static_cast<uint8_t>(pc & 0xFF),
+        static_cast<uint8_t>(pc >> 8),
+        macro_library_playing_slot(),
+    };
+    send_uart_frame(UART_REPLY_MACRO, payload, sizeof(payload));
+}
+
+static void send_macro_slot_list() {
+    for (uint8_t slot = 0; slot < MACRO_LIBRARY_SLOTS; ++slot) {
+        MacroSlotInfo info;
+        macro_library_info(slot, &info);
+        uint8_t payload[5 + MACRO_NAME_LENGTH] = {
+            slot,
+            static_cast<uint8_t>(info.length & 0xFF),
+            static_cast<uint8_t>(info.length >> 8),
+            static_cast<uint8_t>(info.chord & 0xFF),
+            static_cast<uint8_t>(info.chord >> 8),
+        };
+        memcpy(&payload[5], info.name, MACRO_NAME_LENGTH);
+        send_uart_frame(UART_REPLY_MACRO_SLOT, payload, sizeof(payload));
+    }
+}
+
+static void handle_macro_upload(const uint8_t* payload, uint8_t payload_len) {
+    if (payload_len < 2) {
+        send_macro_reply(MACRO_ERR_INVALID);
+        return;
+    }
+    uint16_t offset = static_cast<uint16_t>(payload[0] | (payload[1] << 8));
+    send_macro_reply(macro_player_upload(offset, payload + 2, static_cast<uint8_t>(payload_len - 2)));
+}
+
+static void handle_macro_control(const uint8_t* payload, uint8_t payload_len) {
+    if (payload_len < 1) {
+        send_macro_reply(MACRO_ERR_INVALID);
+        return;
+    }
+    MacroResult result = MACRO_OK;
+    switch (payload[0]) {
+        case MACRO_CONTROL_STOP:
+            macro_player_stop();
+            break;
+        case MACRO_CONTROL_RUN:
+            result = payload_len >= 3 ? macro_player_start_uploaded(static_cast<uint16_t>(payload[1] | (payload[2] << 8)))
+                                      : MACRO_ERR_INVALID;
+            break;
+        case MACRO_CONTROL_STATUS:
+            break;
+        case MACRO_CONTROL_PLAY_SLOT:
+            result = payload_len >= 2 ? macro_library_play(payload[1]) : MACRO_ERR_INVALID;
+            break;
+        case MACRO_CONTROL_SAVE_SLOT:
+            result = payload_len >= 6 ? macro_library_save(payload[1], static_cast<uint16_t>(payload[2] | (payload[3] << 8)),
+                                                           static_cast<uint16_t>(payload[4] | (payload[5] << 8)),
+                                                           reinterpret_cast<const char*>(&payload[6]),
+                                                           static_cast<uint8_t>(payload_len - 6))
+                                      : MACRO_ERR_INVALID;
+            break;
+        case MACRO_CONTROL_DELETE_SLOT:
+            result = payload_len >= 2 ? macro_library_delete(payload[1]) : MACRO_ERR_INVALID;
+            break;
+        case MACRO_CONTROL_LIST:
+            send_macro_slot_list();
+            break;
+        default:
+            result = MACRO_ERR_INVALID;
+            break;
+    }
+    LOG_PRINTF("[MACRO] control 0x%02x -> %u\n", payload[0], result);
+    bool staged = result == MACRO_OK && (payload[0] == MACRO_CONTROL_SAVE_SLOT || payload[0] == MACRO_CONTROL_DELETE_SLOT);
+    if (!staged) {
+        send_macro_reply(result);  // a staged save or delete replies once it is written
+    }
+}
+
+static void service_macro_library() {
+    macro_library_task(switch_pro_next_task_time(), tud_mounted() && !tud_suspended());
+    MacroResult result;
+    if (macro_library_take_result(&result)) {
+        send_macro_reply(result);
+    }
+}
+
+static void send_recorder_reply(RecorderResult result) {
+    uint16_t count = input_recorder_count();
+    uint16_t position = input_recorder_position();
+    uint32_t reports = input_recorder_report_count();
+    uint8_t payload[10] = {
+        static_cast<uint8_t>(result),
+        static_cast<uint8_t>(input_recorder_state()),
+        static_cast<uint8_t>(count & 0xFF),
+        static_cast<uint8_t>(count >> 8),
+        static_cast<uint8_t>(position & 0xFF),
+        static_cast<uint8_t>(position >> 8),
+    };
+    memcpy(&payload[6], &reports, sizeof(reports));
+    send_uart_frame(UART_REPLY_RECORDER, payload, sizeof(payload));
+}
+
+static void send_recorder_runs(uint16_t index) {
+    RecordedRun runs[RECORDER_RUNS_PER_FRAME] = {};
+    uint8_t count = input_recorder_read(index, runs, RECORDER_RUNS_PER_FRAME);
+    uint8_t payload[3 + sizeof(runs)];
+    payload[0] = static_cast<uint8_t>(index & 0xFF);
+    payload[1] = static_cast<uint8_t>(index >> 8);
+    payload[2] = count;
+    memcpy(&payload[3], runs, sizeof(runs));
+    send_uart_frame(UART_REPLY_RECORDER_RUNS, payload, sizeof(payload));
+}
+
+static void handle_recorder_control(const uint8_t* payload, uint8_t payload_len) {
+    if (payload_len < 1) {
+        send_recorder_reply(RECORDER_ERR_INVALID);
+        return;
+    }
+    RecorderResult result = RECORDER_OK;
+    uint16_t index = payload_len >= 3 ? static_cast<uint16_t>(payload[1] | (payload[2] << 8)) : 0;
+    switch (payload[0]) {
+        case RECORDER_CONTROL_STOP:
+            input_recorder_stop();
+            break;
+        case RECORDER_CONTROL_RECORD:
+            input_recorder_record();
+            break;
+        case RECORDER_CONTROL_REPLAY:
+            result = input_recorder_replay();
+            break;
+        case RECORDER_CONTROL_STATUS:
+            break;
+        case RECORDER_CONTROL_READ:
+            if (payload_len >= 3) {
+                send_recorder_runs(index);
+                return;
+            }
+            result = RECORDER_ERR_INVALID;
+            break;
+        case RECORDER_CONTROL_WRITE: {
+            uint8_t run_bytes = static_cast<uint8_t>(payload_len >= 3 ? payload_len - 3 : 0);
+            if (payload_len < 3 || run_bytes % sizeof(RecordedRun) != 0 ||
+                run_bytes > RECORDER_RUNS_PER_FRAME * sizeof(RecordedRun)) {
+                result = RECORDER_ERR_INVALID;
+                break;
+            }
+            RecordedRun runs[RECORDER_RUNS_PER_FRAME];
+            memcpy(runs, &payload[3], run_bytes);
+            result = input_recorder_write(index, runs, static_cast<uint8_t>(run_bytes / sizeof(RecordedRun)));
+            break;
         }
+        default:
+            result = RECORDER_ERR_INVALID;
+            break;
+    }
+    send_recorder_reply(result);
+}
 
-        buffer[index++] = byte;
-        if (index == 3) {
-            expected_len = static_cast<uint8_t>(buffer[2] + 4u);
-            if (expected_len < 12 || expected_len > sizeof(buffer)) {
-                index = 0;
-                expected_len = 0;
-                continue;
+static void handle_turbo_config(const uint8_t* payload, uint8_t payload_len) {
+    bool accepted = payload_len == 4 &&
+                    turbo_configure(static_cast<uint16_t>(payload[0] | (payload[1] << 8)), payload[2], payload[3]);
+    uint16_t enabled = turbo_enabled_mask();
+    uint8_t reply[3] = {
+        static_cast<uint8_t>(accepted),
+        static_cast<uint8_t>(enabled & 0xFF),
+        static_cast<uint8_t>(enabled >> 8),
+    };
+    send_uart_frame(UART_REPLY_TURBO, reply, sizeof(reply));
+}
+
+static void handle_stick_shape_config(const uint8_t* payload, uint8_t payload_len) {
+    StickShapeConfig config;
+    bool accepted = payload_len == 1 + sizeof(config) && (payload[0] & ~0x03) == 0;
+    if (accepted) {
+        memcpy(&config, &payload[1], sizeof(config));
+        accepted = stick_shape_config_valid(config);
+    }
+    if (accepted) {
+        for (uint8_t stick = 0; stick < 2; ++stick) {
+            if (payload[0] & (1u << stick)) {
+                stick_shaper_build(&g_stick_shapers[stick], config);
             }
         }
+    }
+    uint8_t reply = accepted;
+    send_uart_frame(UART_REPLY_STICK_SHAPE, &reply, sizeof(reply));
+}
+
+static void handle_socd_config(const uint8_t* payload, uint8_t payload_len) {
+    uint8_t reply[2];
+    reply[0] = payload_len == 1 && socd_set_mode(payload[0]);
+    reply[1] = static_cast<uint8_t>(socd_mode());
+    send_uart_frame(UART_REPLY_SOCD, reply, sizeof(reply));
+}
 
-        if (expected_len > 0 && index >= expected_len) {
-            SwitchInputState parsed{};
-            if (switch_pro_apply_uart_packet(buffer, expected_len, &parsed)) {
-                g_user_state = parsed;
-                new_data = true;
-                LOG_PRINTF("[UART] packet buttons=0x%04x hat=%u lx=%u ly=%u rx=%u ry=%u\n",
-                           (parsed.button_a   ? SWITCH_PRO_MASK_A   : 0) |
-                           (parsed.button_b   ? SWITCH_PRO_MASK_B   : 0) |
-                           (parsed.button_x   ? SWITCH_PRO_MASK_X   : 0) |
-                           (parsed.button_y   ? SWITCH_PRO_MASK_Y   : 0) |
-                           (parsed.button_l   ? SWITCH_PRO_MASK_L   : 0) |
-                           (parsed.button_r   ? SWITCH_PRO_MASK_R   : 0) |
-                           (parsed.button_zl  ? SWITCH_PRO_MASK_ZL  : 0) |
-                           (parsed.button_zr  ? SWITCH_PRO_MASK_ZR  : 0) |
-                           (parsed.button_plus? SWITCH_PRO_MASK_PLUS: 0) |
-                           (parsed.button_minus?SWITCH_PRO_MASK_MINUS:0) |
-                           (parsed.button_home?SWITCH_PRO_MASK_HOME:0) |
-                           (parsed.button_capture?SWITCH_PRO_MASK_CAPTURE:0) |
-                           (parsed.button_l3  ? SWITCH_PRO_MASK_L3  : 0) |
-                           (parsed.button_r3  ? SWITCH_PRO_MASK_R3  : 0),
-                           parsed.dpad_up ? SWITCH_PRO_HAT_UP :
-                            parsed.dpad_down ? SWITCH_PRO_HAT_DOWN :
-                            parsed.dpad_left ? SWITCH_PRO_HAT_LEFT :
-                            parsed.dpad_right ? SWITCH_PRO_HAT_RIGHT : SWITCH_PRO_HAT_NOTHING,
-                            parsed.lx >> 8, parsed.ly >> 8, parsed.rx >> 8, parsed.ry >> 8);
+static void handle_stick_calibration_control(const uint8_t* payload, uint8_t payload_len) {
+    StickCalibrationResult result = STICK_CALIBRATION_OK;
+    uint8_t saved = 0;
+    switch (payload_len == 1 ? payload[0] : 0xFF) {
+        case STICK_CALIBRATION_CONTROL_STOP:
+            stick_calibration_stop();
+            break;
+        case STICK_CALIBRATION_CONTROL_LEARN:
+            stick_calibration_learn();
+            break;
+        case STICK_CALIBRATION_CONTROL_SAVE:
+            result = stick_calibration_save(&saved);
+            break;
+        case STICK_CALIBRATION_CONTROL_CLEAR:
+            result = stick_calibration_clear();
+            break;
+        case STICK_CALIBRATION_CONTROL_STATUS:
+            break;
+        default:
+            result = STICK_CALIBRATION_ERR_INVALID;
+            break;
+    }
+    uint8_t reply[3 + 2 * 6 * sizeof(uint16_t)] = {
+        static_cast<uint8_t>(result),
+        static_cast<uint8_t>(stick_calibration_learning()),
+        saved,
+    };
+    for (uint8_t stick = 0; stick < 2; ++stick) {
+        StickRange range;
+        stick_calibration_observed(stick, &range);
+        const uint16_t values[6] = {range.x.min, range.x.centre, range.x.max, range.y.min, range.y.centre, range.y.max};
+        memcpy(&reply[3 + stick * sizeof(values)], values, sizeof(values));
+    }
+    send_uart_frame(UART_REPLY_STICK_CALIBRATION, reply, sizeof(reply));
+}
+
+static void handle_merge_config(const uint8_t* payload, uint8_t payload_len) {
+    uint8_t reply[3];
+    reply[0] = payload_len == 1 && input_merge_set_policy(payload[0]);
+    reply[1] = static_cast<uint8_t>(input_merge_policy());
+    reply[2] = input_merge_active_mask();
+    send_uart_frame(UART_REPLY_MERGE, reply, sizeof(reply));
+}
+
+// Apply config frames queued by core 1. Runs on core 0, which owns UART1 TX
+// and the flash-writing modules.
+static void service_config_frames() {
+    ConfigFrame frame;
+    while (g_config_frames.pop(&frame)) {
+        const uint8_t* payload = &frame.data[3];
+        uint8_t payload_len = frame.data[2];
+        switch (frame.data[1]) {
+            case UART_FRAME_IDENTITY_SET: {
+                DeviceIdentityStatus status = DEVICE_IDENTITY_REJECTED;
+                if (payload_len == sizeof(DeviceIdentity)) {
+                    DeviceIdentity identity;
+                    memcpy(&identity, payload, sizeof(identity));
+                    status = device_identity_stage(identity);
+                }
+                LOG_PRINTF("[ID] identity update %s\n", status == DEVICE_IDENTITY_REJECTED ? "rejected" : "staged");
+                send_identity_reply(status == DEVICE_IDENTITY_REJECTED);
+                break;
             }
-            index = 0;
-            expected_len = 0;
+            case UART_FRAME_IDENTITY_GET:
+                send_identity_reply(false);
+                break;
+            case UART_FRAME_MACRO_UPLOAD:
+                handle_macro_upload(payload, payload_len);
+                break;
+            case UART_FRAME_MACRO_CONTROL:
+                handle_macro_control(payload, payload_len);
+                break;
+            case UART_FRAME_RECORDER:
+                handle_recorder_control(payload, payload_len);
+                break;
+            case UART_FRAME_TURBO:
+                handle_turbo_config(payload, payload_len);
+                break;
+            case UART_FRAME_STICK_SHAPE:
+                handle_stick_shape_config(payload, payload_len);
+                break;
+            case UART_FRAME_SOCD:
+                handle_socd_config(payload, payload_len);
+                break;
+            case UART_FRAME_MERGE:
+                handle_merge_config(payload, payload_len);
+                break;
+            case UART_FRAME_STICK_CALIBRATION:
+                handle_stick_calibration_control(payload, payload_len);
+                break;
+            default:
+                LOG_PRINTF("[UART] unknown frame type 0x%02x\n", frame.data[1]);
+                break;
         }
     }
+}
 
-    return new_data;
+// Runs in the driver just before each report is packed. Stages see the host's
+// input first and then one another's output.
+static void __not_in_flash_func(filter_report)(SwitchInputState* state, bool new_report) {
+    socd_apply(state);
+    stick_shaper_apply(g_stick_shapers[0], &state->lx, &state->ly);
+    stick_shaper_apply(g_stick_shapers[1], &state->rx, &state->ry);
+    stick_calibration_apply(state, new_report);  // learns the shaped range the host can reach
+    macro_library_apply(state, new_report);  // may start or stop the player
+    turbo_apply(state, new_report);
+    macro_player_apply(state, new_report);
+    input_recorder_apply(state, new_report);  // last: records or replays the final report
+}
+
+// Make every interrupt that becomes pending set the event register, so an IRQ
+// landing between the last work check and WFE still wakes the core.
+static void enable_sleep_on_pending_irq() {
+    hw_set_bits(&scb_hw->scr, M0PLUS_SCR_SEVONPEND_BITS);
+}
+
+// Core 1 owns serial ingest: draining the RX FIFOs, frame sync, checksum
+// validation and conversion to SwitchInputState. Core 0 never waits on it.
+// Between bursts it sleeps in WFE; core 0's UART1 handler wakes it on RX data.
+static void core1_main() {
+    flash_safe_execute_core_init();  // let core 0 pause us while it writes flash
+    enable_sleep_on_pending_irq();
+#ifdef SWITCH_PICO_PIO_RX
+    pio_serial_rx_init(SWITCH_PICO_PIO_RX_MODE, SWITCH_PICO_PIO_RX_PIN, SWITCH_PICO_PIO_RX_BAUD);
+#endif
+    uart_hw_t* hw = uart_get_hw(UART_ID);
+    while (true) {
+        bool new_data = poll_uart_frames();
+#ifdef SWITCH_PICO_PIO_RX
+        new_data |= poll_pio_frames();
+#endif
+        if (new_data || !g_config_frames.empty()) {
+            __sev(); // core 0 may be waiting for input
+        }
+
+        // Re-arm the RX wake-up; if bytes slipped in since the drain it fires at once.
+        hw_set_bits(&hw->imsc, UART_RX_WAKE_BITS);
+#ifdef SWITCH_PICO_PIO_RX
+        // DMA fills the PIO ring without interrupts, so poll it on a short timer.
+        best_effort_wfe_or_timeout(make_timeout_time_us(PIO_RX_POLL_INTERVAL_US));
+#else
+        __wfe();
+#endif
+    }
+}
+
+// Drop links whose host stopped sending, so a crashed host's buttons do not stay held.
+static void expire_serial_inputs() {
+    absolute_time_t now = get_absolute_time();
+    for (uint8_t link = 0; link < SERIAL_INPUT_LINKS; ++link) {
+        if (!(input_merge_active_mask() & (1u << link)) || absolute_time_diff_us(now, g_serial_input_expiry[link]) > 0) {
+            continue;
+        }
+        input_merge_clear(static_cast<InputSlot>(link));
+        g_serial_input_expiry[link] = at_the_end_of_time;
+        LOG_PRINTF("[INPUT] link %u silent, dropped from the merge\n", link);
+    }
+}
+
+// Core 0 idles here until USB, UART1 TX, core 1 input or a deadline needs it.
+static void wait_for_work(const uint32_t* input_sequences) {
+    if (tud_task_event_ready() || !g_config_frames.empty()) {
+        return;
+    }
+    for (uint8_t link = 0; link < SERIAL_INPUT_LINKS; ++link) {
+        if (g_serial_input[link].sequence() != input_sequences[link]) {
+            return;
+        }
+    }
+    absolute_time_t deadline = switch_pro_next_task_time();
+    absolute_time_t rumble_deadline = next_rumble_service_time();
+    if (absolute_time_diff_us(rumble_deadline, deadline) > 0) {
+        deadline = rumble_deadline;
+    }
+    absolute_time_t store_deadline = spi_flash_store_next_task_time();
+    if (absolute_time_diff_us(store_deadline, deadline) > 0) {
+        deadline = store_deadline;
+    }
+    absolute_time_t macro_deadline = macro_library_next_task_time();
+    if (absolute_time_diff_us(macro_deadline, deadline) > 0) {
+        deadline = macro_deadline;
+    }
+    for (uint8_t link = 0; link < SERIAL_INPUT_LINKS; ++link) {
+        if ((input_merge_active_mask() & (1u << link)) &&
+            absolute_time_diff_us(g_serial_input_expiry[link], deadline) > 0) {
+            deadline = g_serial_input_expiry[link];
+        }
+    }
+    absolute_time_t identity_deadline = device_identity_next_task_time();
+    if (absolute_time_diff_us(identity_deadline, deadline) > 0) {
+        deadline = identity_deadline;
+    }
+    best_effort_wfe_or_timeout(deadline);
+}
+
+#ifdef SWITCH_PICO_BENCH
+#ifdef PICO_COPY_TO_RAM
+#define BENCH_IMAGE_NAME "ram"
+#else
+#define BENCH_IMAGE_NAME "flash"
+#endif
+
+// Cycles per stick for the axial table lookup and the radial fixed-point path
+// (tools/bench_stick_shaping.cpp checks the latter's accuracy on the host).
+static void bench_stick_shaping() {
+    const uint32_t iterations = 1000;
+    StickShapeConfig config = {8, 15, 92, 60, 0};
+    StickShaper shaper;
+    uint32_t cycles[2];
+    for (uint8_t radial = 0; radial < 2; ++radial) {
+        config.flags = radial ? STICK_SHAPE_RADIAL | STICK_SHAPE_CIRCLE : 0;
+        stick_shaper_build(&shaper, config);
+        uint32_t start = bench_cycles_now();
+        for (uint32_t i = 0; i < iterations; ++i) {
+            uint16_t x = static_cast<uint16_t>(i * 65), y = static_cast<uint16_t>(0xFFFF - i * 37);
+            stick_shaper_apply(shaper, &x, &y);
+        }
+        cycles[radial] = bench_cycles_since(start);
+    }
+    printf("[BENCH] stick shaping axial=%lu radial=%lu cycles/stick (x%lu)\n", (unsigned long)(cycles[0] / iterations),
+           (unsigned long)(cycles[1] / iterations), (unsigned long)iterations);
 }
 
+static uint32_t g_loop_worst_cycles = 0;
+static uint32_t g_loop_passes = 0;
+static uint32_t g_loop_report_ms = 0;
+
+// Track the longest active main-loop pass (WFE time excluded) and print it
+// once a second. The print happens after timing so it is never counted.
+static void bench_record_loop_pass(uint32_t start) {
+    uint32_t cycles = bench_cycles_since(start);
+    if (cycles > g_loop_worst_cycles) {
+        g_loop_worst_cycles = cycles;
+    }
+    g_loop_passes++;
+
+    uint32_t now_ms = to_ms_since_boot(get_absolute_time());
+    if (now_ms - g_loop_report_ms >= 1000) {
+        printf("[BENCH] loop (%s) worst=%lu cycles over %lu passes\n", BENCH_IMAGE_NAME,
+               (unsigned long)g_loop_worst_cycles, (unsigned long)g_loop_passes);
+        g_loop_worst_cycles = 0;
+        g_loop_passes = 0;
+        g_loop_report_ms = now_ms;
+    }
+}
+#endif
+
 static void log_usb_state() {
     bool mounted = tud_mounted();
     bool ready = switch_pro_is_ready();
@@ -154,24 +876,70 @@ int main() {
     stdio_init_all();
 
     init_uart_input();
+#ifdef SWITCH_PICO_GPIO_BUTTONS
+    gpio_buttons_init();  // sampling IRQ on core 0, which also consumes it
+#endif
 
     tusb_init();
     switch_pro_init();
+    macro_library_init();
     switch_pro_set_rumble_callback(on_rumble_from_switch);
+    const StickShapeConfig default_shape = STICK_SHAPE_DEFAULT;
+    stick_shaper_build(&g_stick_shapers[0], default_shape);
+    stick_shaper_build(&g_stick_shapers[1], default_shape);
+    switch_pro_set_report_filter(filter_report);
     g_user_state = neutral_input();
     switch_pro_set_input(g_user_state);
 
+#ifdef SWITCH_PICO_BENCH
+    switch_pro_run_benchmarks();
+    bench_stick_shaping();
+#endif
+
     LOG_PRINTF("[BOOT] switch-pico starting (UART0 log @ 115200)\n");
     LOG_PRINTF("[INFO] UART1 pins TX=%d RX=%d baud=%d\n",
            UART_TX_PIN, UART_RX_PIN, BAUD_RATE);
 
+    enable_sleep_on_pending_irq();
+    multicore_launch_core1(core1_main);  // Serial RX ingest runs on core 1
+
+#ifdef SWITCH_PICO_BENCH
+    bench_cycle_counter_init();
+#endif
+
+    uint32_t input_sequences[SERIAL_INPUT_LINKS] = {};
+    SwitchInputState serial_state;
     while (true) {
+#ifdef SWITCH_PICO_BENCH
+        uint32_t pass_start = bench_cycles_now();
+#endif
         tud_task();          // USB device tasks
-        bool new_data = poll_uart_frames();  // Pull controller state from UART1
-        (void)new_data;
-        SwitchInputState state = g_user_state;
-        switch_pro_set_input(state);
+        service_rumble();    // Forward coalesced rumble back to the host
+        for (uint8_t link = 0; link < SERIAL_INPUT_LINKS; ++link) {  // Newest states from core 1
+            if (g_serial_input[link].read_if_newer(&input_sequences[link], &serial_state)) {
+                input_merge_set(static_cast<InputSlot>(link), serial_state);
+                g_serial_input_expiry[link] = make_timeout_time_us(SERIAL_INPUT_TIMEOUT_US);
+            }
+        }
+        expire_serial_inputs();
+#ifdef SWITCH_PICO_GPIO_BUTTONS
+        SwitchInputState gpio_state;
+        if (gpio_buttons_poll(&gpio_state)) {  // Buttons wired to the Pico
+            input_merge_set(INPUT_SLOT_GPIO, gpio_state);
+        }
+#endif
+        if (input_merge_update(&g_user_state)) {  // Combine every source
+            switch_pro_set_input(g_user_state);
+        }
         switch_pro_task();   // Push state to the Switch host
+        service_config_frames();  // Identity and other settings from the host
+        device_identity_task();   // Store a new identity and reboot into it
+        spi_flash_store_task(switch_pro_next_task_time(), tud_mounted() && !tud_suspended());  // Persist SPI writes between reports
+        service_macro_library();  // Write a staged macro save or delete between reports
         log_usb_state();
+#ifdef SWITCH_PICO_BENCH
+        bench_record_loop_pass(pass_start);
+#endif
+        wait_for_work(input_sequences);
     }
 }
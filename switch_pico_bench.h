@@ -0,0 +1,28 @@
+/*
+ * Cycle counting helpers for the optional SWITCH_PICO_BENCH build.
+ * The Cortex-M0+ has no DWT cycle counter, so SysTick is run from the
+ * processor clock as a free-running 24-bit down counter instead.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include "hardware/structs/systick.h"
+
+#define BENCH_SYSTICK_MASK 0x00FFFFFFu
+
+static inline void bench_cycle_counter_init() {
+    systick_hw->csr = 0;
+    systick_hw->rvr = BENCH_SYSTICK_MASK;
+    systick_hw->cvr = 0;
+    systick_hw->csr = M0PLUS_SYST_CSR_CLKSOURCE_BITS | M0PLUS_SYST_CSR_ENABLE_BITS;
+}
+
+static inline uint32_t bench_cycles_now() {
+    return systick_hw->cvr;
+}
+
+// SysTick counts down, so elapsed cycles are start - end modulo 2^24.
+static inline uint32_t bench_cycles_since(uint32_t start) {
+    return (start - systick_hw->cvr) & BENCH_SYSTICK_MASK;
+}
@@ -7,6 +7,7 @@
 
 #pragma once
 
+#include <stdbool.h>
 #include <stdint.h>
 
 #define SWITCH_PRO_ENDPOINT_SIZE 64
@@ -68,6 +69,8 @@ typedef enum {
     TRIGGER_BUTTONS = 0x04,
     SET_SHIPMENT = 0x08,
     SPI_READ = 0x10,
+    SPI_WRITE = 0x11,
+    SPI_ERASE = 0x12,
     SET_NFC_IR_CONFIG = 0x21,
     SET_NFC_IR_STATE = 0x22,
     SET_PLAYER_LIGHTS = 0x30,
@@ -240,6 +243,16 @@ typedef struct __attribute((packed, aligned(1)))
     uint8_t motionCalibration[24];
 } SwitchUserCalibration;
 
+// SPI address of SwitchUserCalibration. A stick's block is only used while
+// its magic is present; resetting a stick in System Settings erases it.
+#define SWITCH_USER_CALIBRATION_ADDRESS 0x8000
+#define SWITCH_USER_CALIBRATION_MAGIC_0 0xB2
+#define SWITCH_USER_CALIBRATION_MAGIC_1 0xA1
+
+static inline bool switch_user_calibration_magic_valid(const uint8_t magic[2]) {
+    return magic[0] == SWITCH_USER_CALIBRATION_MAGIC_0 && magic[1] == SWITCH_USER_CALIBRATION_MAGIC_1;
+}
+
 typedef struct __attribute((packed, aligned(1)))
 {
     uint8_t connectionInfo : 4;
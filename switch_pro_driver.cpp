@@ -1,12 +1,20 @@
 #include "switch_pro_driver.h"
 
 #include <algorithm>
+#include <cstddef>
 #include <cstring>
-#include <map>
 #include <stdio.h>
-#include "pico/rand.h"
 #include "pico/time.h"
 #include "tusb.h"
+#include "device_identity.h"
+#include "seqlock_snapshot.h"
+#include "spi_flash_image.h"
+#include "spi_flash_store.h"
+#include "uart_protocol.h"
+
+#ifdef SWITCH_PICO_BENCH
+#include "switch_pico_bench.h"
+#endif
 
 #ifdef SWITCH_PICO_LOG
 #define LOG_PRINTF(...) printf(__VA_ARGS__)
@@ -17,23 +25,45 @@
 // force a report to be sent every X ms
 #define SWITCH_PRO_KEEPALIVE_TIMER 5
 
-static SwitchInputState g_input_state{
+static constexpr SwitchInputState neutral_input_state{
     false, false, false, false,
     false, false, false, false, false, false, false, false,
     false, false, false, false, false, false,
     SWITCH_PRO_JOYSTICK_MID, SWITCH_PRO_JOYSTICK_MID,
     SWITCH_PRO_JOYSTICK_MID, SWITCH_PRO_JOYSTICK_MID};
 
+// Written by switch_pro_set_input(); the report builder works from its own
+// consistent copy so producers never race with report packing.
+static SeqlockSnapshot<SwitchInputState> g_input_snapshot{neutral_input_state};
+static SwitchInputState g_input_state = neutral_input_state;
+static uint32_t g_input_sequence = 0;
+
+// imuData sits at byte 13 of the packed report. Three lead bytes in front of a
+// word-aligned slot put it on a word boundary so IMU packing can use 32-bit copies.
+static_assert(offsetof(SwitchProReport, imuData) == 13, "IMU data offset changed; update lead padding");
+static_assert(sizeof(SwitchImuSample) == 12, "SwitchImuSample must match the 12-byte wire layout");
+static_assert(offsetof(SwitchInputState, imu_samples) % 4 == 0, "imu_samples must be word aligned");
+static_assert(__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__, "IMU packing copies little-endian samples as-is");
+
+static struct __attribute__((packed, aligned(4))) {
+    uint8_t lead[3];
+    SwitchProReport report;
+} report_slot{};
+
 static uint8_t report_buffer[SWITCH_PRO_ENDPOINT_SIZE] = {};
 static uint8_t last_report[SWITCH_PRO_ENDPOINT_SIZE] = {};
-static SwitchProReport switch_report{};
+static SwitchProReport& switch_report = report_slot.report;
+static uint32_t packed_imu_generation = 0;
+static uint8_t packed_imu_count = 0xFF;
 static uint8_t last_report_counter = 0;
 static uint32_t last_report_timer = 0;
+static uint32_t input_reports_sent = 0;
 static uint32_t last_host_activity_ms = 0;
 static bool is_ready = false;
 static bool is_initialized = false;
 static bool is_report_queued = false;
 static bool report_sent = false;
+static bool input_report_pending = false;  // filters stepped for switch_report; resend until it goes out
 static uint8_t queued_report_id = 0;
 static bool forced_ready = false;
 static uint8_t handshake_counter = 0;
@@ -76,6 +106,7 @@ static uint16_t rightMinX, rightMinY;
 static uint16_t rightCenX, rightCenY;
 static uint16_t rightMaxX, rightMaxY;
 static SwitchRumbleCallback rumble_callback = nullptr;
+static SwitchReportFilter report_filter = nullptr;
 
 static const uint8_t factory_config_data[0xEFF] = {
     // serial number
@@ -174,39 +205,52 @@ static const uint8_t user_calibration_data[0x3F] = {
     0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff
 };
 
-static const SwitchFactoryConfig* factory_config = reinterpret_cast<const SwitchFactoryConfig*>(factory_config_data);
 static const SwitchUserCalibration* user_calibration [[maybe_unused]] = reinterpret_cast<const SwitchUserCalibration*>(user_calibration_data);
 
-static std::map<uint32_t, const uint8_t*> spi_flash_data = {
-    {0x6000, factory_config_data},
-    {0x8000, user_calibration_data}
+// Built-in SPI contents, used for any page an imported SPI image does not provide.
+static constexpr SpiFlashConstPage default_spi_pages[] = {
+    {0x6000, factory_config_data, sizeof(factory_config_data)},
+    {SWITCH_USER_CALIBRATION_ADDRESS, user_calibration_data, sizeof(user_calibration_data)},
 };
 
-static inline uint16_t scale16To12(uint16_t pos) { return pos >> 4; }
+// Factory page with the unit's identity patched in. It is mapped as the
+// constant backing of 0x6000, so console writes are still diffed against it.
+static uint8_t identity_factory_page[SPI_FLASH_PAGE_SIZE];
+
+static constexpr bool default_spi_pages_valid() {
+    for (const SpiFlashConstPage& page : default_spi_pages) {
+        if (page.address % SPI_FLASH_PAGE_SIZE != 0 || page.length > SPI_FLASH_PAGE_SIZE) {
+            return false;
+        }
+    }
+    return true;
+}
+static_assert(default_spi_pages_valid(), "default SPI pages must be page aligned and fit in one page");
 
-static void fill_imu_report_data(const SwitchInputState& state) {
-    if (state.imu_sample_count == 0) {
+static inline void copy_imu_sample(uint8_t* dst, const SwitchImuSample* src) {
+    // Both sides are word aligned, so this lowers to three 32-bit load/store pairs.
+    memcpy(__builtin_assume_aligned(dst, 4), __builtin_assume_aligned(src, 4), sizeof(SwitchImuSample));
+}
+
+static void __not_in_flash_func(fill_imu_report_data)(const SwitchInputState& state) {
+    uint8_t sample_count = state.imu_sample_count > 3 ? 3 : state.imu_sample_count;
+    // The same samples are offered on every loop pass; only repack when they change.
+    if (sample_count == packed_imu_count && state.imu_generation == packed_imu_generation) {
+        return;
+    }
+    packed_imu_count = sample_count;
+    packed_imu_generation = state.imu_generation;
+
+    if (sample_count == 0) {
         memset(switch_report.imuData, 0x00, sizeof(switch_report.imuData));
         return;
     }
-    uint8_t sample_count = state.imu_sample_count > 3 ? 3 : state.imu_sample_count;
-    // If fewer than 3 samples, duplicate the last one to fill all 3 slots
+    // SwitchImuSample already matches the wire layout. If fewer than 3 samples,
+    // duplicate the last one to fill all 3 slots.
     uint8_t* dst = switch_report.imuData;
     for (uint8_t i = 0; i < 3; ++i) {
-        const SwitchImuSample& s = (i < sample_count) ? state.imu_samples[i] : state.imu_samples[sample_count - 1];
-        dst[0]  = static_cast<uint8_t>(s.accel_x & 0xFF);
-        dst[1]  = static_cast<uint8_t>((s.accel_x >> 8) & 0xFF);
-        dst[2]  = static_cast<uint8_t>(s.accel_y & 0xFF);
-        dst[3]  = static_cast<uint8_t>((s.accel_y >> 8) & 0xFF);
-        dst[4]  = static_cast<uint8_t>(s.accel_z & 0xFF);
-        dst[5]  = static_cast<uint8_t>((s.accel_z >> 8) & 0xFF);
-        dst[6]  = static_cast<uint8_t>(s.gyro_x & 0xFF);
-        dst[7]  = static_cast<uint8_t>((s.gyro_x >> 8) & 0xFF);
-        dst[8]  = static_cast<uint8_t>(s.gyro_y & 0xFF);
-        dst[9]  = static_cast<uint8_t>((s.gyro_y >> 8) & 0xFF);
-        dst[10] = static_cast<uint8_t>(s.gyro_z & 0xFF);
-        dst[11] = static_cast<uint8_t>((s.gyro_z >> 8) & 0xFF);
-        dst += 12;
+        copy_imu_sample(dst, &state.imu_samples[i < sample_count ? i : sample_count - 1]);
+        dst += sizeof(SwitchImuSample);
     }
 }
 
@@ -244,19 +288,6 @@ static bool send_report(uint8_t reportID, const void* reportData, uint16_t repor
     return result;
 }
 
-static void read_spi_flash(uint8_t* dest, uint32_t address, uint8_t size) {
-    uint32_t addressBank = address & 0xFFFFFF00;
-    uint32_t addressOffset = address & 0x000000FF;
-    auto it = spi_flash_data.find(addressBank);
-
-    if (it != spi_flash_data.end()) {
-        const uint8_t* data = it->second;
-        memcpy(dest, data + addressOffset, size);
-    } else {
-        memset(dest, 0xFF, size);
-    }
-}
-
 static void forward_rumble_to_host(const uint8_t* report, uint16_t length) {
     // Output reports 0x10/0x21 include 8 rumble bytes starting at offset 2.
     if (!rumble_callback || length < 10) {
@@ -321,6 +352,8 @@ static void handle_feature_report(uint8_t switchReportID, uint8_t switchReportSu
     uint8_t commandID = reportData[10];
     uint32_t spiReadAddress = 0;
     uint8_t spiReadSize = 0;
+    uint32_t spiWriteAddress = 0;
+    uint8_t spiWriteSize = 0;
     bool canSend = false;
     last_host_activity_ms = to_ms_since_boot(get_absolute_time());
 
@@ -373,6 +406,9 @@ static void handle_feature_report(uint8_t switchReportID, uint8_t switchReportSu
         case SPI_READ:
             spiReadAddress = (reportData[14] << 24) | (reportData[13] << 16) | (reportData[12] << 8) | (reportData[11]);
             spiReadSize = reportData[15];
+            if (spiReadSize > sizeof(report_buffer) - 20) {
+                spiReadSize = sizeof(report_buffer) - 20; // reply data starts at byte 20
+            }
             report_buffer[13] = 0x90;
             report_buffer[14] = reportData[10];
             report_buffer[15] = reportData[11];
@@ -380,10 +416,35 @@ static void handle_feature_report(uint8_t switchReportID, uint8_t switchReportSu
             report_buffer[17] = reportData[13];
             report_buffer[18] = reportData[14];
             report_buffer[19] = reportData[15];
-            read_spi_flash(&report_buffer[20], spiReadAddress, spiReadSize);
+            spi_flash_read(spiReadAddress, &report_buffer[20], spiReadSize);
             canSend = true;
             LOG_PRINTF("[HID] FEATURE SPI_READ addr=0x%08lx size=%u\n", (unsigned long)spiReadAddress, spiReadSize);
             break;
+        case SPI_WRITE:
+            // Applied to the virtual SPI image now; persisted to Pico flash later
+            // by spi_flash_store_task(), outside the USB callback.
+            spiWriteAddress = (reportData[14] << 24) | (reportData[13] << 16) | (reportData[12] << 8) | (reportData[11]);
+            spiWriteSize = reportData[15];
+            if (reportLength < 16 || spiWriteSize > reportLength - 16) {
+                spiWriteSize = reportLength < 16 ? 0 : static_cast<uint8_t>(reportLength - 16);
+            }
+            report_buffer[13] = 0x80;
+            report_buffer[14] = commandID;
+            report_buffer[15] = spi_flash_store_write(spiWriteAddress, &reportData[16], spiWriteSize) ? 0x00 : 0x01;
+            switch_pro_reload_stick_calibration();  // the console may have recalibrated the sticks
+            canSend = true;
+            LOG_PRINTF("[HID] FEATURE SPI_WRITE addr=0x%08lx size=%u status=%u\n",
+                       (unsigned long)spiWriteAddress, spiWriteSize, report_buffer[15]);
+            break;
+        case SPI_ERASE:
+            spiWriteAddress = (reportData[14] << 24) | (reportData[13] << 16) | (reportData[12] << 8) | (reportData[11]);
+            report_buffer[13] = 0x80;
+            report_buffer[14] = commandID;
+            report_buffer[15] = spi_flash_store_erase(spiWriteAddress) ? 0x00 : 0x01;
+            switch_pro_reload_stick_calibration();
+            canSend = true;
+            LOG_PRINTF("[HID] FEATURE SPI_ERASE addr=0x%08lx status=%u\n", (unsigned long)spiWriteAddress, report_buffer[15]);
+            break;
         case SET_NFC_IR_CONFIG:
             report_buffer[13] = 0x80;
             report_buffer[14] = commandID;
@@ -475,47 +536,88 @@ static void handle_feature_report(uint8_t switchReportID, uint8_t switchReportSu
     if (canSend) is_report_queued = true;
 }
 
-static void update_switch_report_from_state() {
-    switch_report.inputs.dpadUp =    g_input_state.dpad_up;
-    switch_report.inputs.dpadDown =  g_input_state.dpad_down;
-    switch_report.inputs.dpadLeft =  g_input_state.dpad_left;
-    switch_report.inputs.dpadRight = g_input_state.dpad_right;
+static void __not_in_flash_func(pack_input_state)(const SwitchInputState& state) {
+    switch_report.inputs.dpadUp =    state.dpad_up;
+    switch_report.inputs.dpadDown =  state.dpad_down;
+    switch_report.inputs.dpadLeft =  state.dpad_left;
+    switch_report.inputs.dpadRight = state.dpad_right;
 
     switch_report.inputs.chargingGrip = 1;
 
-    switch_report.inputs.buttonY = g_input_state.button_y;
-    switch_report.inputs.buttonX = g_input_state.button_x;
-    switch_report.inputs.buttonB = g_input_state.button_b;
-    switch_report.inputs.buttonA = g_input_state.button_a;
+    switch_report.inputs.buttonY = state.button_y;
+    switch_report.inputs.buttonX = state.button_x;
+    switch_report.inputs.buttonB = state.button_b;
+    switch_report.inputs.buttonA = state.button_a;
     switch_report.inputs.buttonRightSR = 0;
     switch_report.inputs.buttonRightSL = 0;
-    switch_report.inputs.buttonR = g_input_state.button_r;
-    switch_report.inputs.buttonZR = g_input_state.button_zr;
-    switch_report.inputs.buttonMinus = g_input_state.button_minus;
-    switch_report.inputs.buttonPlus = g_input_state.button_plus;
-    switch_report.inputs.buttonThumbR = g_input_state.button_r3;
-    switch_report.inputs.buttonThumbL = g_input_state.button_l3;
-    switch_report.inputs.buttonHome = g_input_state.button_home;
-    switch_report.inputs.buttonCapture = g_input_state.button_capture;
+    switch_report.inputs.buttonR = state.button_r;
+    switch_report.inputs.buttonZR = state.button_zr;
+    switch_report.inputs.buttonMinus = state.button_minus;
+    switch_report.inputs.buttonPlus = state.button_plus;
+    switch_report.inputs.buttonThumbR = state.button_r3;
+    switch_report.inputs.buttonThumbL = state.button_l3;
+    switch_report.inputs.buttonHome = state.button_home;
+    switch_report.inputs.buttonCapture = state.button_capture;
     switch_report.inputs.buttonLeftSR = 0;
     switch_report.inputs.buttonLeftSL = 0;
-    switch_report.inputs.buttonL = g_input_state.button_l;
-    switch_report.inputs.buttonZL = g_input_state.button_zl;
+    switch_report.inputs.buttonL = state.button_l;
+    switch_report.inputs.buttonZL = state.button_zl;
 
-    uint16_t scaleLeftStickX = scale16To12(g_input_state.lx);
-    uint16_t scaleLeftStickY = scale16To12(g_input_state.ly);
-    uint16_t scaleRightStickX = scale16To12(g_input_state.rx);
-    uint16_t scaleRightStickY = scale16To12(g_input_state.ry);
+    uint16_t scaleLeftStickX = switch_stick_report_x(state.lx);
+    uint16_t scaleLeftStickY = switch_stick_report_y(state.ly);
+    uint16_t scaleRightStickX = switch_stick_report_x(state.rx);
+    uint16_t scaleRightStickY = switch_stick_report_y(state.ry);
 
     switch_report.inputs.leftStick.setX(std::min(std::max(scaleLeftStickX,leftMinX), leftMaxX));
-    switch_report.inputs.leftStick.setY(-std::min(std::max(scaleLeftStickY,leftMinY), leftMaxY));
+    switch_report.inputs.leftStick.setY(std::min(std::max(scaleLeftStickY,leftMinY), leftMaxY));
     switch_report.inputs.rightStick.setX(std::min(std::max(scaleRightStickX,rightMinX), rightMaxX));
-    switch_report.inputs.rightStick.setY(-std::min(std::max(scaleRightStickY,rightMinY), rightMaxY));
+    switch_report.inputs.rightStick.setY(std::min(std::max(scaleRightStickY,rightMinY), rightMaxY));
 
-    fill_imu_report_data(g_input_state);
+    fill_imu_report_data(state);
     switch_report.rumbleReport = 0x09;
 }
 
+static void __not_in_flash_func(update_switch_report_from_state)(bool new_report) {
+    g_input_snapshot.read_if_newer(&g_input_sequence, &g_input_state);
+    if (!report_filter) {
+        pack_input_state(g_input_state);
+        return;
+    }
+    SwitchInputState filtered = g_input_state;
+    report_filter(&filtered, new_report);
+    pack_input_state(filtered);
+}
+
+// Serve the identity's serial, type and colours from the factory page.
+// Seed the first-boot identity from a factory page served out of an imported
+// SPI dump, so the dump's serial and colours survive the identity record.
+static void seed_identity_from_spi(DeviceIdentity* identity) {
+    spi_flash_read(0x6000, identity_factory_page, sizeof(identity_factory_page));
+    const SwitchFactoryConfig* config = reinterpret_cast<const SwitchFactoryConfig*>(identity_factory_page);
+    memcpy(identity->serial, config->serialNumber, sizeof(identity->serial));
+    if (config->colorInfo == 0x01 || config->colorInfo == 0x02) {  // body and buttons stored
+        memcpy(identity->body_color, &config->bodyColor, 3);
+        memcpy(identity->button_color, &config->buttonColor, 3);
+    }
+    if (config->colorInfo == 0x02) {  // grips stored too
+        memcpy(identity->left_grip_color, &config->leftGripColor, 3);
+        memcpy(identity->right_grip_color, &config->rightGripColor, 3);
+    }
+}
+
+static void apply_identity_to_spi(const DeviceIdentity& identity) {
+    spi_flash_read(0x6000, identity_factory_page, sizeof(identity_factory_page));
+    SwitchFactoryConfig* config = reinterpret_cast<SwitchFactoryConfig*>(identity_factory_page);
+    memcpy(config->serialNumber, identity.serial, sizeof(config->serialNumber));
+    config->deviceType = identity.controller_type;
+    config->colorInfo = 0x02;  // use the colours below rather than the console defaults
+    memcpy(&config->bodyColor, identity.body_color, 3);
+    memcpy(&config->buttonColor, identity.button_color, 3);
+    memcpy(&config->leftGripColor, identity.left_grip_color, 3);
+    memcpy(&config->rightGripColor, identity.right_grip_color, 3);
+    spi_flash_map_const(0x6000, identity_factory_page, sizeof(identity_factory_page));
+}
+
 void switch_pro_init() {
     player_id = 0;
     last_report_counter = 0;
@@ -524,18 +626,46 @@ void switch_pro_init() {
     is_initialized = false;
     is_report_queued = false;
     report_sent = false;
+    input_report_pending = false;
     forced_ready = false;
     forced_ready = true;
     is_ready = true;
     is_initialized = true;
     last_report_timer = 0;
 
+    // Pages from an imported dump (SWITCH_PICO_SPI_IMAGE) take precedence.
+    spi_flash_image_init();
+    const bool image_has_factory_page = spi_flash_is_mapped(0x6000);
+    for (const SpiFlashConstPage& page : default_spi_pages) {
+        if (!spi_flash_is_mapped(page.address)) {
+            spi_flash_map_const(page.address, page.data, page.length);
+        }
+    }
+
+    // First-boot identity; the colours come from controller_color_config.h
+    // unless an imported dump supplies its own serial and colours.
+    DeviceIdentity default_identity = {
+        .mac = {0x7c, 0xbb, 0x8a, 0x00, 0x00, 0x00},
+        .controller_type = SWITCH_TYPE_PRO_CONTROLLER,
+        .serial = {0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+                   0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF},
+        .body_color = {SWITCH_COLOR_BODY_R, SWITCH_COLOR_BODY_G, SWITCH_COLOR_BODY_B},
+        .button_color = {SWITCH_COLOR_BUTTON_R, SWITCH_COLOR_BUTTON_G, SWITCH_COLOR_BUTTON_B},
+        .left_grip_color = {SWITCH_COLOR_LEFT_GRIP_R, SWITCH_COLOR_LEFT_GRIP_G, SWITCH_COLOR_LEFT_GRIP_B},
+        .right_grip_color = {SWITCH_COLOR_RIGHT_GRIP_R, SWITCH_COLOR_RIGHT_GRIP_G, SWITCH_COLOR_RIGHT_GRIP_B},
+    };
+    if (image_has_factory_page) {
+        seed_identity_from_spi(&default_identity);
+    }
+    DeviceIdentity identity;
+    device_identity_load(default_identity, &identity);
+
     device_info = {
         .majorVersion = 0x04,
         .minorVersion = 0x91,
-        .controllerType = SWITCH_TYPE_PRO_CONTROLLER,
+        .controllerType = identity.controller_type,
         .unknown00 = 0x02,
-        .macAddress = {0x7c, 0xbb, 0x8a, static_cast<uint8_t>(get_rand_32() % 0xff), static_cast<uint8_t>(get_rand_32() % 0xff), static_cast<uint8_t>(get_rand_32() % 0xff)},
+        .macAddress = {identity.mac[0], identity.mac[1], identity.mac[2], identity.mac[3], identity.mac[4], identity.mac[5]},
         .unknown01 = 0x01,
         .storedColors = 0x02,
     };
@@ -585,23 +715,50 @@ void switch_pro_init() {
     last_report_timer = to_ms_since_boot(get_absolute_time());
     last_host_activity_ms = last_report_timer;
 
-    factory_config->leftStickCalibration.getRealMin(leftMinX, leftMinY);
-    factory_config->leftStickCalibration.getCenter(leftCenX, leftCenY);
-    factory_config->leftStickCalibration.getRealMax(leftMaxX, leftMaxY);
-    factory_config->rightStickCalibration.getRealMin(rightMinX, rightMinY);
-    factory_config->rightStickCalibration.getCenter(rightCenX, rightCenY);
-    factory_config->rightStickCalibration.getRealMax(rightMaxX, rightMaxY);
+    apply_identity_to_spi(identity);
+    spi_flash_store_init();  // replay calibration the console saved earlier
+    switch_pro_reload_stick_calibration();
+}
+
+void switch_pro_reload_stick_calibration() {
+    // Clamp sticks to the calibration the console will use: the user block
+    // for each stick that has one, otherwise the factory block.
+    SwitchUserCalibration user;
+    spi_flash_read(SWITCH_USER_CALIBRATION_ADDRESS, reinterpret_cast<uint8_t*>(&user), sizeof(user));
+    SwitchLeftCalibration left_calibration = user.leftCalibration;
+    SwitchRightCalibration right_calibration = user.rightCalibration;
+    if (!switch_user_calibration_magic_valid(user.leftCalibrationMagic)) {
+        spi_flash_read(0x6000 + offsetof(SwitchFactoryConfig, leftStickCalibration),
+                       reinterpret_cast<uint8_t*>(&left_calibration), sizeof(left_calibration));
+    }
+    if (!switch_user_calibration_magic_valid(user.rightCalibrationMagic)) {
+        spi_flash_read(0x6000 + offsetof(SwitchFactoryConfig, rightStickCalibration),
+                       reinterpret_cast<uint8_t*>(&right_calibration), sizeof(right_calibration));
+    }
+    left_calibration.getRealMin(leftMinX, leftMinY);
+    left_calibration.getCenter(leftCenX, leftCenY);
+    left_calibration.getRealMax(leftMaxX, leftMaxY);
+    right_calibration.getRealMin(rightMinX, rightMinY);
+    right_calibration.getCenter(rightCenX, rightCenY);
+    right_calibration.getRealMax(rightMaxX, rightMaxY);
 }
 
-void switch_pro_set_input(const SwitchInputState& state) {
-    g_input_state = state;
+void __not_in_flash_func(switch_pro_set_input)(const SwitchInputState& state) {
+    g_input_snapshot.write(state);
 }
 
-void switch_pro_task() {
+void __not_in_flash_func(switch_pro_task)() {
     uint32_t now = to_ms_since_boot(get_absolute_time());
     report_sent = false;
 
-    update_switch_report_from_state();
+    // The filter advances once per input report sent, and only on a pass that
+    // can send one, so the report carries fresh input. If send_report() still
+    // fails, the stepped report is kept as is for the retry.
+    if (!input_report_pending) {
+        input_report_pending = is_ready && !is_report_queued &&
+                               (now - last_report_timer) > SWITCH_PRO_KEEPALIVE_TIMER && tud_hid_ready();
+        update_switch_report_from_state(input_report_pending);
+    }
 
     if (tud_suspended()) {
         tud_remote_wakeup();
@@ -618,17 +775,17 @@ void switch_pro_task() {
     }
 
     if (is_ready && !report_sent) {
-        if ((now - last_report_timer) > SWITCH_PRO_KEEPALIVE_TIMER) {
+        if (input_report_pending) {
             switch_report.timestamp = last_report_counter;
             void * inputReport = &switch_report;
             uint16_t report_size = sizeof(switch_report);
             if (tud_hid_ready() && send_report(0, inputReport, report_size) == true ) {
                 memcpy(last_report, inputReport, report_size);
-                g_input_state.imu_sample_count = 0;
                 report_sent = true;
+                input_report_pending = false;
+                input_reports_sent++;
+                last_report_timer = now;
             }
-
-            last_report_timer = now;
         }
     } else {
         if (!is_initialized) {
@@ -643,15 +800,32 @@ void switch_pro_task() {
     }
 }
 
-bool switch_pro_apply_uart_packet(const uint8_t* packet, uint8_t length, SwitchInputState* out_state) {
+absolute_time_t switch_pro_next_task_time() {
+    if (!is_report_queued && !is_ready && is_initialized) {
+        return at_the_end_of_time; // waiting on the host; USB events wake the loop
+    }
+    // switch_pro_task() sends once more than SWITCH_PRO_KEEPALIVE_TIMER whole
+    // milliseconds have passed since last_report_timer.
+    uint64_t now_us = time_us_64();
+    uint32_t elapsed_ms = static_cast<uint32_t>(now_us / 1000) - last_report_timer;
+    if (elapsed_ms > SWITCH_PRO_KEEPALIVE_TIMER) {
+        // Overdue: run now, unless the IN endpoint is still busy, in which case
+        // its completion interrupt is the next thing worth waking for.
+        return tud_hid_ready() ? get_absolute_time() : at_the_end_of_time;
+    }
+    uint64_t next_ms_us = now_us - (now_us % 1000) + 1000;
+    return from_us_since_boot(next_ms_us + (uint64_t)(SWITCH_PRO_KEEPALIVE_TIMER - elapsed_ms) * 1000);
+}
+
+bool __not_in_flash_func(switch_pro_apply_uart_packet)(const uint8_t* packet, uint8_t length, SwitchInputState* out_state) {
     // v2 format: 0xAA + 0x02 + payload_len + payload... + checksum
     if (length < 12) {
         return false;
     }
-    if (packet[0] != 0xAA) {
+    if (packet[0] != UART_FRAME_HEADER) {
         return false;
     }
-    if (packet[1] != 0x02) {
+    if (packet[1] != UART_FRAME_INPUT) {
         return false;
     }
 
@@ -696,6 +870,10 @@ bool switch_pro_apply_uart_packet(const uint8_t* packet, uint8_t length, SwitchI
 
     SwitchInputState state = make_neutral_state();
     state.imu_sample_count = imu_count;
+    if (imu_count > 0) {
+        static uint32_t imu_generation = 0;
+        state.imu_generation = ++imu_generation;
+    }
 
     auto read_int16 = [](const uint8_t* src) -> int16_t {
         return static_cast<int16_t>(static_cast<uint16_t>(src[0]) | (static_cast<uint16_t>(src[1]) << 8));
@@ -710,32 +888,8 @@ bool switch_pro_apply_uart_packet(const uint8_t* packet, uint8_t length, SwitchI
         state.imu_samples[i].gyro_z = read_int16(base + 10);
     }
 
-    switch (out.hat) {
-        case SWITCH_PRO_HAT_UP: state.dpad_up = true; break;
-        case SWITCH_PRO_HAT_UPRIGHT: state.dpad_up = true; state.dpad_right = true; break;
-        case SWITCH_PRO_HAT_RIGHT: state.dpad_right = true; break;
-        case SWITCH_PRO_HAT_DOWNRIGHT: state.dpad_down = true; state.dpad_right = true; break;
-        case SWITCH_PRO_HAT_DOWN: state.dpad_down = true; break;
-        case SWITCH_PRO_HAT_DOWNLEFT: state.dpad_down = true; state.dpad_left = true; break;
-        case SWITCH_PRO_HAT_LEFT: state.dpad_left = true; break;
-        case SWITCH_PRO_HAT_UPLEFT: state.dpad_up = true; state.dpad_left = true; break;
-        default: break;
-    }
-
-    state.button_y = out.buttons & SWITCH_PRO_MASK_Y;
-    state.button_x = out.buttons & SWITCH_PRO_MASK_X;
-    state.button_b = out.buttons & SWITCH_PRO_MASK_B;
-    state.button_a = out.buttons & SWITCH_PRO_MASK_A;
-    state.button_r = out.buttons & SWITCH_PRO_MASK_R;
-    state.button_zr = out.buttons & SWITCH_PRO_MASK_ZR;
-    state.button_plus = out.buttons & SWITCH_PRO_MASK_PLUS;
-    state.button_minus = out.buttons & SWITCH_PRO_MASK_MINUS;
-    state.button_r3 = out.buttons & SWITCH_PRO_MASK_R3;
-    state.button_l3 = out.buttons & SWITCH_PRO_MASK_L3;
-    state.button_home = out.buttons & SWITCH_PRO_MASK_HOME;
-    state.button_capture = out.buttons & SWITCH_PRO_MASK_CAPTURE;
-    state.button_zl = out.buttons & SWITCH_PRO_MASK_ZL;
-    state.button_l = out.buttons & SWITCH_PRO_MASK_L;
+    switch_input_set_uart_hat(&state, out.hat);
+    switch_input_set_buttons(&state, out.buttons);
 
     state.lx = expand_axis(out.lx);
     state.ly = expand_axis(out.ly);
@@ -743,20 +897,167 @@ bool switch_pro_apply_uart_packet(const uint8_t* packet, uint8_t length, SwitchI
     state.ry = expand_axis(out.ry);
 
     if (!out_state) {
-        return false;
+        switch_pro_set_input(state);
+        return true;
     }
     *out_state = state;
     return true;
 }
 
+uint16_t __not_in_flash_func(switch_input_buttons)(const SwitchInputState& state) {
+    return (state.button_y ? SWITCH_PRO_MASK_Y : 0) |
+           (state.button_b ? SWITCH_PRO_MASK_B : 0) |
+           (state.button_a ? SWITCH_PRO_MASK_A : 0) |
+           (state.button_x ? SWITCH_PRO_MASK_X : 0) |
+           (state.button_l ? SWITCH_PRO_MASK_L : 0) |
+           (state.button_r ? SWITCH_PRO_MASK_R : 0) |
+           (state.button_zl ? SWITCH_PRO_MASK_ZL : 0) |
+           (state.button_zr ? SWITCH_PRO_MASK_ZR : 0) |
+           (state.button_minus ? SWITCH_PRO_MASK_MINUS : 0) |
+           (state.button_plus ? SWITCH_PRO_MASK_PLUS : 0) |
+           (state.button_l3 ? SWITCH_PRO_MASK_L3 : 0) |
+           (state.button_r3 ? SWITCH_PRO_MASK_R3 : 0) |
+           (state.button_home ? SWITCH_PRO_MASK_HOME : 0) |
+           (state.button_capture ? SWITCH_PRO_MASK_CAPTURE : 0);
+}
+
+void __not_in_flash_func(switch_input_set_buttons)(SwitchInputState* state, uint16_t buttons) {
+    state->button_y = buttons & SWITCH_PRO_MASK_Y;
+    state->button_x = buttons & SWITCH_PRO_MASK_X;
+    state->button_b = buttons & SWITCH_PRO_MASK_B;
+    state->button_a = buttons & SWITCH_PRO_MASK_A;
+    state->button_r = buttons & SWITCH_PRO_MASK_R;
+    state->button_zr = buttons & SWITCH_PRO_MASK_ZR;
+    state->button_plus = buttons & SWITCH_PRO_MASK_PLUS;
+    state->button_minus = buttons & SWITCH_PRO_MASK_MINUS;
+    state->button_r3 = buttons & SWITCH_PRO_MASK_R3;
+    state->button_l3 = buttons & SWITCH_PRO_MASK_L3;
+    state->button_home = buttons & SWITCH_PRO_MASK_HOME;
+    state->button_capture = buttons & SWITCH_PRO_MASK_CAPTURE;
+    state->button_zl = buttons & SWITCH_PRO_MASK_ZL;
+    state->button_l = buttons & SWITCH_PRO_MASK_L;
+}
+
+uint8_t __not_in_flash_func(switch_input_hat)(const SwitchInputState& state) {
+    if (state.dpad_up) {
+        return state.dpad_right ? SWITCH_PRO_HAT_UPRIGHT : state.dpad_left ? SWITCH_PRO_HAT_UPLEFT : SWITCH_PRO_HAT_UP;
+    }
+    if (state.dpad_down) {
+        return state.dpad_right ? SWITCH_PRO_HAT_DOWNRIGHT : state.dpad_left ? SWITCH_PRO_HAT_DOWNLEFT : SWITCH_PRO_HAT_DOWN;
+    }
+    if (state.dpad_right) {
+        return SWITCH_PRO_HAT_RIGHT;
+    }
+    return state.dpad_left ? SWITCH_PRO_HAT_LEFT : SWITCH_PRO_HAT_NOTHING;
+}
+
+void __not_in_flash_func(switch_input_set_hat)(SwitchInputState* state, uint8_t hat) {
+    state->dpad_up = hat == SWITCH_PRO_HAT_UP || hat == SWITCH_PRO_HAT_UPRIGHT || hat == SWITCH_PRO_HAT_UPLEFT;
+    state->dpad_down = hat == SWITCH_PRO_HAT_DOWN || hat == SWITCH_PRO_HAT_DOWNRIGHT || hat == SWITCH_PRO_HAT_DOWNLEFT;
+    state->dpad_right = hat == SWITCH_PRO_HAT_RIGHT || hat == SWITCH_PRO_HAT_UPRIGHT || hat == SWITCH_PRO_HAT_DOWNRIGHT;
+    state->dpad_left = hat == SWITCH_PRO_HAT_LEFT || hat == SWITCH_PRO_HAT_UPLEFT || hat == SWITCH_PRO_HAT_DOWNLEFT;
+}
+
+uint8_t __not_in_flash_func(switch_input_raw_dpad)(const SwitchInputState& state) {
+    return static_cast<uint8_t>(UART_HAT_RAW | (state.dpad_up ? UART_HAT_RAW_UP : 0) |
+                                (state.dpad_down ? UART_HAT_RAW_DOWN : 0) | (state.dpad_left ? UART_HAT_RAW_LEFT : 0) |
+                                (state.dpad_right ? UART_HAT_RAW_RIGHT : 0));
+}
+
+void __not_in_flash_func(switch_input_set_uart_hat)(SwitchInputState* state, uint8_t hat) {
+    if (hat & UART_HAT_RAW) {
+        state->dpad_up = hat & UART_HAT_RAW_UP;
+        state->dpad_down = hat & UART_HAT_RAW_DOWN;
+        state->dpad_left = hat & UART_HAT_RAW_LEFT;
+        state->dpad_right = hat & UART_HAT_RAW_RIGHT;
+    } else {
+        switch_input_set_hat(state, hat);
+    }
+}
+
 void switch_pro_set_rumble_callback(SwitchRumbleCallback cb) {
     rumble_callback = cb;
 }
 
+void switch_pro_set_report_filter(SwitchReportFilter filter) {
+    report_filter = filter;
+}
+
 bool switch_pro_is_ready() {
     return is_ready;
 }
 
+uint32_t switch_pro_input_reports_sent() {
+    return input_reports_sent;
+}
+
+#ifdef SWITCH_PICO_BENCH
+// Reference implementation: the original shift-and-mask packer.
+static void __attribute__((noinline)) fill_imu_report_data_bytewise(const SwitchInputState& state) {
+    uint8_t sample_count = state.imu_sample_count > 3 ? 3 : state.imu_sample_count;
+    uint8_t* dst = switch_report.imuData;
+    for (uint8_t i = 0; i < 3; ++i) {
+        const SwitchImuSample& s = (i < sample_count) ? state.imu_samples[i] : state.imu_samples[sample_count - 1];
+        dst[0]  = static_cast<uint8_t>(s.accel_x & 0xFF);
+        dst[1]  = static_cast<uint8_t>((s.accel_x >> 8) & 0xFF);
+        dst[2]  = static_cast<uint8_t>(s.accel_y & 0xFF);
+        dst[3]  = static_cast<uint8_t>((s.accel_y >> 8) & 0xFF);
+        dst[4]  = static_cast<uint8_t>(s.accel_z & 0xFF);
+        dst[5]  = static_cast<uint8_t>((s.accel_z >> 8) & 0xFF);
+        dst[6]  = static_cast<uint8_t>(s.gyro_x & 0xFF);
+        dst[7]  = static_cast<uint8_t>((s.gyro_x >> 8) & 0xFF);
+        dst[8]  = static_cast<uint8_t>(s.gyro_y & 0xFF);
+        dst[9]  = static_cast<uint8_t>((s.gyro_y >> 8) & 0xFF);
+        dst[10] = static_cast<uint8_t>(s.gyro_z & 0xFF);
+        dst[11] = static_cast<uint8_t>((s.gyro_z >> 8) & 0xFF);
+        dst += 12;
+    }
+}
+
+static void __attribute__((noinline)) fill_imu_report_data_bench(const SwitchInputState& state) {
+    fill_imu_report_data(state);
+}
+
+void switch_pro_run_benchmarks() {
+    const uint32_t iterations = 1000;
+    SwitchInputState state = make_neutral_state();
+    state.imu_sample_count = 3;
+    for (uint8_t i = 0; i < 3; ++i) {
+        state.imu_samples[i] = {static_cast<int16_t>(100 + i), -200, 4096, 50, -50, static_cast<int16_t>(i)};
+    }
+
+    bench_cycle_counter_init();
+
+    uint32_t start = bench_cycles_now();
+    for (uint32_t i = 0; i < iterations; ++i) {
+        fill_imu_report_data_bytewise(state);
+    }
+    uint32_t bytewise = bench_cycles_since(start);
+    uint8_t reference[sizeof(switch_report.imuData)];
+    memcpy(reference, switch_report.imuData, sizeof(reference));
+
+    start = bench_cycles_now();
+    for (uint32_t i = 0; i < iterations; ++i) {
+        state.imu_generation = i + 1; // force a repack every pass
+        fill_imu_report_data_bench(state);
+    }
+    uint32_t wordwise = bench_cycles_since(start);
+    bool matches = memcmp(reference, switch_report.imuData, sizeof(reference)) == 0;
+
+    start = bench_cycles_now();
+    for (uint32_t i = 0; i < iterations; ++i) {
+        fill_imu_report_data_bench(state);
+    }
+    uint32_t unchanged = bench_cycles_since(start);
+
+    printf("[BENCH] imu pack bytewise=%lu word=%lu unchanged=%lu cycles/call (x%lu) match=%s\n",
+           (unsigned long)(bytewise / iterations), (unsigned long)(wordwise / iterations),
+           (unsigned long)(unchanged / iterations), (unsigned long)iterations, matches ? "yes" : "NO");
+
+    packed_imu_count = 0xFF; // make the first real report repack
+}
+#endif
+
 // HID callbacks
 uint16_t tud_hid_get_report_cb(uint8_t instance, uint8_t report_id, hid_report_type_t report_type, uint8_t *buffer, uint16_t reqlen) {
     (void)instance;
@@ -8,6 +8,7 @@
 
 #include <stdbool.h>
 #include <stdint.h>
+#include "pico/time.h"
 #include "switch_pro_descriptors.h"
 
 typedef struct {
@@ -46,25 +47,75 @@ typedef struct {
     uint16_t ry;
 
     uint8_t imu_sample_count;     // 0-3
+    uint32_t imu_generation;      // bumped whenever imu_samples carries new data
     SwitchImuSample imu_samples[3];
 } SwitchInputState;
 
 // Initialize USB state and calibration before entering the main loop.
 void switch_pro_init();
 
-// Update the desired controller state for the next USB report.
+// Update the desired controller state for the next USB report. Never blocks;
+// must only be called from one context (core or IRQ) at a time.
 void switch_pro_set_input(const SwitchInputState& state);
 
 // Drive the Switch Pro USB state machine; call this frequently in the main loop.
 void switch_pro_task();
 
+// Earliest time switch_pro_task() has timed work (a report or keepalive).
+// USB traffic can create work sooner; that arrives via tud_task().
+absolute_time_t switch_pro_next_task_time();
+
 // Convert a packed UART message into controller state (returns true if parsed).
 // If out_state is null the parsed state is written directly to the driver.
 bool switch_pro_apply_uart_packet(const uint8_t* packet, uint8_t length, SwitchInputState* out_state = nullptr);
 
+// A 16-bit stick axis as the 12-bit value the input report carries, which is
+// what the console's stick calibration describes. The report's Y axis points
+// up, so Y is mirrored (and can come out as 4096 before clamping).
+static inline uint16_t switch_stick_report_x(uint16_t value) {
+    return static_cast<uint16_t>(value >> 4);
+}
+static inline uint16_t switch_stick_report_y(uint16_t value) {
+    return static_cast<uint16_t>(4096 - (value >> 4));
+}
+
+// Reload the stick clamping range from the calibration served over SPI (the
+// user block where present, else factory). Call after changing either.
+void switch_pro_reload_stick_calibration();
+
+// Button bitmask (SWITCH_PRO_MASK_*) and hat (SWITCH_PRO_HAT_*) views of a state.
+uint16_t switch_input_buttons(const SwitchInputState& state);
+void switch_input_set_buttons(SwitchInputState* state, uint16_t buttons);
+uint8_t switch_input_hat(const SwitchInputState& state);
+void switch_input_set_hat(SwitchInputState* state, uint8_t hat);
+
+// The four dpad bits in the UART raw hat encoding (UART_HAT_RAW | UART_HAT_RAW_*),
+// which unlike a hat keeps opposing directions held together.
+uint8_t switch_input_raw_dpad(const SwitchInputState& state);
+
+// Set the dpad from a UART hat byte: raw directions or a SWITCH_PRO_HAT_* value.
+void switch_input_set_uart_hat(SwitchInputState* state, uint8_t hat);
+
+// Optional hook that may rewrite the state just before it is packed into the
+// input report. It runs on switch_pro_task() passes (so subcommand replies
+// see current input) with new_report set exactly once per 0x30 report sent,
+// on a pass where the IN endpoint is free; if that send fails, the report is
+// retried unchanged and the hook is not called meanwhile. Per-report state (macros, turbo, recording) should
+// only advance when new_report is set.
+typedef void (*SwitchReportFilter)(SwitchInputState* state, bool new_report);
+void switch_pro_set_report_filter(SwitchReportFilter filter);
+
 // Driver state helpers
 bool switch_pro_is_ready();
 
+// 0x30 input reports successfully sent since boot.
+uint32_t switch_pro_input_reports_sent();
+
 // Optional callback fired when the host sends a rumble payload (the raw 8 rumble bytes).
 typedef void (*SwitchRumbleCallback)(const uint8_t rumble_data[8]);
 void switch_pro_set_rumble_callback(SwitchRumbleCallback cb);
+
+#ifdef SWITCH_PICO_BENCH
+// Print cycle counts for the report packing paths over the stdio UART.
+void switch_pro_run_benchmarks();
+#endif
@@ -0,0 +1,60 @@
+#include "switch_rumble.h"
+
+// Amplitude code (0-100 valid, clamped above) to linear amplitude 0-255.
+static const uint8_t amplitude_table[128] = {
+    0x00, 0x02, 0x03, 0x03, 0x04, 0x04, 0x05, 0x06, 0x07, 0x09, 0x0B, 0x0D, 0x0F, 0x12, 0x15, 0x19,
+    0x1E, 0x1F, 0x21, 0x22, 0x24, 0x25, 0x27, 0x29, 0x2A, 0x2C, 0x2E, 0x30, 0x32, 0x35, 0x37, 0x39,
+    0x3B, 0x3C, 0x3D, 0x3F, 0x40, 0x41, 0x43, 0x44, 0x46, 0x47, 0x49, 0x4A, 0x4C, 0x4E, 0x4F, 0x51,
+    0x53, 0x55, 0x57, 0x58, 0x5A, 0x5C, 0x5E, 0x60, 0x63, 0x65, 0x67, 0x69, 0x6B, 0x6E, 0x70, 0x73,
+    0x75, 0x78, 0x7A, 0x7D, 0x80, 0x83, 0x85, 0x88, 0x8B, 0x8E, 0x91, 0x95, 0x98, 0x9B, 0x9F, 0xA2,
+    0xA6, 0xA9, 0xAD, 0xB1, 0xB5, 0xB9, 0xBD, 0xC1, 0xC5, 0xC9, 0xCE, 0xD2, 0xD7, 0xDC, 0xE0, 0xE5,
+    0xEA, 0xEF, 0xF5, 0xFA, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+};
+
+// 256 * 2^(k/32): mantissa of the exponential frequency scale.
+static const uint16_t frequency_mantissa[32] = {
+    256, 262, 267, 273, 279, 285, 292, 298,
+    304, 311, 318, 325, 332, 339, 347, 354,
+    362, 370, 378, 386, 395, 403, 412, 421,
+    431, 440, 450, 459, 470, 480, 490, 501,
+};
+
+// Frequency is 10 * 2^(code/32) Hz; in 5 Hz units that is 2^(1 + code/32).
+static uint8_t frequency_from_code(uint8_t code) {
+    uint32_t scaled = static_cast<uint32_t>(frequency_mantissa[code & 0x1F]) << (1 + (code >> 5));
+    return static_cast<uint8_t>((scaled + 128) >> 8);
+}
+
+typedef struct {
+    uint8_t high_amp;
+    uint8_t high_freq;
+    uint8_t low_amp;
+    uint8_t low_freq;
+} SideBands;
+
+static SideBands decode_side(const uint8_t* data) {
+    SideBands side;
+    // High band: 9-bit frequency (low 2 bits always zero) and a 7-bit amplitude code.
+    uint16_t high_freq = static_cast<uint16_t>(data[0]) | (static_cast<uint16_t>(data[1] & 0x01) << 8);
+    side.high_freq = frequency_from_code(static_cast<uint8_t>((high_freq >> 2) + 0x60));
+    side.high_amp = amplitude_table[data[1] >> 1];
+    // Low band: 7-bit frequency; the amplitude code LSB lives in bit 7 of byte 2
+    // and the rest in byte 3, offset by 0x40.
+    side.low_freq = frequency_from_code(static_cast<uint8_t>((data[2] & 0x7F) + 0x40));
+    uint16_t low_code = data[3] >= 0x40 ? static_cast<uint16_t>(((data[3] - 0x40) << 1) | (data[2] >> 7)) : 0;
+    side.low_amp = amplitude_table[low_code > 127 ? 127 : low_code];
+    return side;
+}
+
+void switch_rumble_decode(const uint8_t rumble[8], SwitchRumbleBands* out) {
+    SideBands left = decode_side(&rumble[0]);
+    SideBands right = decode_side(&rumble[4]);
+
+    const SideBands& low = right.low_amp > left.low_amp ? right : left;
+    const SideBands& high = right.high_amp > left.high_amp ? right : left;
+    out->low_amp = low.low_amp;
+    out->low_freq = low.low_freq;
+    out->high_amp = high.high_amp;
+    out->high_freq = high.high_freq;
+}
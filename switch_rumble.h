@@ -0,0 +1,26 @@
+/*
+ * Decoder for the Switch HD rumble encoding carried in 0x10/0x21 output
+ * reports. Each side (left, right) packs a high band and a low band, each
+ * with a log-scaled frequency and amplitude code.
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+// Both bands merged across the two sides. Amplitudes are linear 0-255;
+// frequencies are in 5 Hz units (40-1250 Hz fits in a byte).
+typedef struct {
+    uint8_t low_amp;
+    uint8_t low_freq;
+    uint8_t high_amp;
+    uint8_t high_freq;
+} SwitchRumbleBands;
+
+// Decode the 8 raw rumble bytes (left side first) into merged band amplitudes
+// and frequencies. Each band takes the stronger side's amplitude and frequency.
+void switch_rumble_decode(const uint8_t rumble[8], SwitchRumbleBands* out);
+
+static inline bool switch_rumble_is_idle(const SwitchRumbleBands& bands) {
+    return bands.low_amp == 0 && bands.high_amp == 0;
+}
@@ -0,0 +1,84 @@
+"""Tests for the controller identity record and its UART frames."""
+
+import argparse
+
+import pytest
+from switch_pico_bridge.provision_identity import apply_arguments
+from switch_pico_bridge.switch_pico_uart import (
+    IDENTITY_RECORD_LENGTH,
+    IDENTITY_STATUS_PENDING,
+    PICO_REPLY_IDENTITY,
+    RUMBLE_HEADER,
+    RUMBLE_TYPE_COMPACT,
+    UART_FRAME_IDENTITY_GET,
+    UART_FRAME_IDENTITY_SET,
+    UART_HEADER,
+    ControllerIdentity,
+    build_frame,
+    compute_checksum,
+    decode_identity_reply,
+    parse_mac,
+)
+from tests.test_uart_protocol import make_uart, rumble_frame
+
+
+def sample_identity() -> ControllerIdentity:
+    return ControllerIdentity(
+        mac=parse_mac("7c:bb:8a:12:34:56"),
+        serial="XCW10000000001",
+        body_color=(0x10, 0x20, 0x30),
+        left_grip_color=(0xEC, 0x00, 0x8C),
+    )
+
+
+def test_identity_record_layout():
+    data = sample_identity().to_bytes()
+    assert len(data) == IDENTITY_RECORD_LENGTH
+    assert data[:6] == bytes([0x7C, 0xBB, 0x8A, 0x12, 0x34, 0x56])
+    assert data[6] == 0x03
+    assert data[7:23] == b"XCW10000000001\x00\x00"
+    assert data[23:26] == bytes([0x10, 0x20, 0x30])
+    assert data[29:32] == bytes([0xEC, 0x00, 0x8C])
+    assert ControllerIdentity.from_bytes(data) == sample_identity()
+
+
+def test_empty_serial_is_erased():
+    identity = ControllerIdentity(mac=bytes(6))
+    assert identity.to_bytes()[7:23] == b"\xff" * 16
+    assert ControllerIdentity.from_bytes(identity.to_bytes()).serial == ""
+    with pytest.raises(ValueError):
+        ControllerIdentity(serial="X" * 17).to_bytes()
+
+
+def test_identity_frames():
+    get = build_frame(UART_FRAME_IDENTITY_GET)
+    assert get == bytes([UART_HEADER, UART_FRAME_IDENTITY_GET, 0, compute_checksum(get[:-1])])
+    payload = sample_identity().to_bytes()
+    frame = build_frame(UART_FRAME_IDENTITY_SET, payload)
+    assert frame[:3] == bytes([UART_HEADER, UART_FRAME_IDENTITY_SET, IDENTITY_RECORD_LENGTH])
+    assert frame[3:-1] == payload
+    assert frame[-1] == compute_checksum(frame[:-1])
+
+
+def test_identity_reply_is_read_and_skipped_by_rumble_reader():
+    reply = bytes([RUMBLE_HEADER, PICO_REPLY_IDENTITY, IDENTITY_STATUS_PENDING]) + sample_identity().to_bytes()
+    reply += bytes([compute_checksum(reply)])
+    compact = rumble_frame(RUMBLE_TYPE_COMPACT, bytes([10, 32, 20, 64]))
+
+    uart = make_uart(reply + compact)
+    frame_type, payload = uart.read_frame()
+    assert frame_type == PICO_REPLY_IDENTITY
+    assert decode_identity_reply(payload) == (IDENTITY_STATUS_PENDING, sample_identity())
+
+    uart = make_uart(reply + compact)
+    assert uart.read_rumble_payload() == bytes([10, 32, 20, 64])
+
+
+def test_provision_arguments_only_touch_given_fields():
+    args = argparse.Namespace(
+        mac=None, type=None, serial=None, body=None, buttons="#00FF00", left_grip=None, right_grip=None, grip="112233"
+    )
+    updated = apply_arguments(sample_identity(), args)
+    assert updated.mac == sample_identity().mac
+    assert updated.button_color == (0, 0xFF, 0)
+    assert updated.left_grip_color == updated.right_grip_color == (0x11, 0x22, 0x33)
@@ -0,0 +1,133 @@
+"""Tests for the macro bytecode builder and its upload framing."""
+
+import struct
+
+import pytest
+from switch_pico_bridge.switch_pico_uart import (
+    MACRO_CONTROL_SAVE_SLOT,
+    MACRO_NO_SLOT,
+    MACRO_SLOT_SIZE,
+    PICO_REPLY_MACRO,
+    PICO_REPLY_MACRO_SLOT,
+    RUMBLE_HEADER,
+    UART_FRAME_MAX_PAYLOAD,
+    MacroBuilder,
+    MacroOp,
+    MacroSlot,
+    SwitchButton,
+    SwitchDpad,
+    compute_checksum,
+    macro_save_payload,
+    macro_upload_frames,
+)
+from tests.test_uart_protocol import make_uart
+
+
+def test_builder_encodes_operands_little_endian():
+    program = (
+        MacroBuilder()
+        .press(SwitchButton.A, SwitchButton.ZR)
+        .wait_ms(1.5)
+        .hat(SwitchDpad.LEFT)
+        .left_stick(0.0, -1.0)
+        .release(SwitchButton.A)
+        .wait_reports(3)
+        .build()
+    )
+    assert program == bytes(
+        [MacroOp.PRESS, 0x84, 0x00]
+        + [MacroOp.WAIT_US, 0xDC, 0x05, 0x00, 0x00]
+        + [MacroOp.HAT, 0x06]
+        + [MacroOp.LSTICK, 128, 0]
+        + [MacroOp.RELEASE, 0x04, 0x00]
+        + [MacroOp.WAIT_REPORTS, 3, 0]
+        + [MacroOp.END]
+    )
+
+
+def test_loops_and_labels():
+    macro = MacroBuilder().neutral().label("top")
+    with macro.loop(2):
+        macro.press(SwitchButton.B).wait_reports(1)
+    macro.jump("top")
+    program = macro.build()
+    assert program[1:4] == bytes([MacroOp.LOOP, 2, 0])
+    assert program[10] == MacroOp.ENDLOOP
+    assert program[11:14] == bytes([MacroOp.JUMP]) + struct.pack("<H", 1)
+    assert program[-1] == MacroOp.END
+
+    with pytest.raises(ValueError):
+        MacroBuilder().jump("missing").build()
+
+
+def test_jumps_must_stay_in_their_loop():
+    macro = MacroBuilder()
+    with macro.loop(0):
+        macro.label("body").press(SwitchButton.A).wait_reports(1).jump("body")
+    macro.build()
+
+    out_of_loop = MacroBuilder()
+    with out_of_loop.loop(3):
+        out_of_loop.jump("after")
+    out_of_loop.label("after")
+    with pytest.raises(ValueError):
+        out_of_loop.build()
+
+    into_loop = MacroBuilder().jump("inside")
+    with into_loop.loop(3):
+        into_loop.label("inside").neutral()
+    with pytest.raises(ValueError):
+        into_loop.build()
+
+
+def test_program_size_is_limited_to_the_slot():
+    macro = MacroBuilder()
+    for _ in range(MACRO_SLOT_SIZE // 3 + 1):
+        macro.wait_reports(1)
+    with pytest.raises(ValueError):
+        macro.build()
+
+
+def test_upload_frames_cover_program_with_offsets():
+    program = bytes(range(150))
+    frames = macro_upload_frames(program)
+    assert all(len(f) <= UART_FRAME_MAX_PAYLOAD for f in frames)
+    rebuilt = bytearray()
+    for frame in frames:
+        assert struct.unpack_from("<H", frame)[0] == len(rebuilt)
+        rebuilt += frame[2:]
+    assert bytes(rebuilt) == program
+
+
+def test_macro_reply_is_parsed():
+    reply = bytes([RUMBLE_HEADER, PICO_REPLY_MACRO, 0, 1, 0x34, 0x01, MACRO_NO_SLOT])
+    uart = make_uart(reply + bytes([compute_checksum(reply)]))
+    status = uart.read_macro_status(timeout=0.0)
+    assert status.ok and status.state == 1 and status.pc == 0x134 and status.slot == MACRO_NO_SLOT
+
+
+def test_save_payload_layout():
+    payload = macro_save_payload(3, 0x123, "farm", SwitchButton.L | SwitchButton.R)
+    assert payload == bytes([MACRO_CONTROL_SAVE_SLOT, 3, 0x23, 0x01, 0x30, 0x00]) + b"farm"
+
+
+@pytest.mark.parametrize(
+    "kwargs",
+    [
+        {"slot": 8},
+        {"name": "x" * 17},
+        {"chord": SwitchButton.A},  # one button would be swallowed whole
+    ],
+)
+def test_save_payload_rejects_bad_arguments(kwargs):
+    args = {"slot": 0, "name": "", "chord": 0, **kwargs}
+    with pytest.raises(ValueError):
+        macro_save_payload(args["slot"], 10, args["name"], args["chord"])
+
+
+def test_slot_reply_is_parsed():
+    payload = bytes([2, 0x40, 0x00, 0x03, 0x00]) + b"jump".ljust(16, b"\x00")
+    frame = bytes([RUMBLE_HEADER, PICO_REPLY_MACRO_SLOT]) + payload
+    uart = make_uart(frame + bytes([compute_checksum(frame)]))
+    slot = MacroSlot.from_bytes(uart.wait_for_frame(PICO_REPLY_MACRO_SLOT, timeout=0.0))
+    assert slot == MacroSlot(2, 0x40, SwitchButton.Y | SwitchButton.B, "jump")
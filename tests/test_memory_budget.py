@@ -0,0 +1,45 @@
+"""Tests for tools/memory_budget.py."""
+
+import importlib.util
+from pathlib import Path
+
+_TOOL = Path(__file__).resolve().parent.parent / "tools" / "memory_budget.py"
+_spec = importlib.util.spec_from_file_location("memory_budget", _TOOL)
+memory_budget = importlib.util.module_from_spec(_spec)
+_spec.loader.exec_module(memory_budget)
+
+NM_OUTPUT = """\
+268435712 00000120 T switch_pro_task()
+268440000 00003839 r factory_config_data
+536870912 00000064 D report_slot
+536871000 00004096 b g_ram_pages
+536875000 00000200 T uart_tx_drain()
+         U __flash_binary_end
+"""
+
+
+def test_parse_nm_classifies_sections_and_regions():
+    symbols = memory_budget.parse_nm(NM_OUTPUT)
+    assert [s.section for s in symbols] == [".text", ".rodata", ".data", ".bss", ".text"]
+    totals = memory_budget.summarize(symbols)
+    assert totals["ram"] == 64 + 4096 + 200
+    # .data initialisers and RAM-resident code are also stored in flash.
+    assert totals["flash"] == 120 + 3839 + 64 + 200
+
+
+def test_heap_symbols_detects_allocators():
+    symbols = memory_budget.parse_nm(
+        "268435712 00000040 T malloc\n268435800 00000010 T operator new(unsigned int)\n"
+    ) + memory_budget.parse_nm(NM_OUTPUT)
+    assert memory_budget.heap_symbols(symbols) == ["malloc", "operator new(unsigned int)"]
+
+
+def test_parse_stack_usage_lines():
+    frames = memory_budget.parse_stack_usage(
+        "switch_pro_driver.cpp:640:6:void switch_pro_task()\t48\tstatic\n"
+        "spi_flash_store.cpp:300:6:void spi_flash_store_task(absolute_time_t, bool)\t296\tstatic\n"
+    )
+    assert [(f.function, f.size) for f in frames] == [
+        ("void switch_pro_task()", 48),
+        ("void spi_flash_store_task(absolute_time_t, bool)", 296),
+    ]
@@ -0,0 +1,20 @@
+"""Tests for the stick merge config frame."""
+
+from switch_pico_bridge.switch_pico_uart import (
+    INPUT_SLOT_GPIO,
+    INPUT_SLOT_UART,
+    PICO_REPLY_MERGE,
+    StickMergePolicy,
+)
+from tests.test_uart_protocol import make_uart, rumble_frame
+
+
+def test_merge_reply_frame_is_known():
+    payload = bytes([1, StickMergePolicy.MAX_MAGNITUDE, INPUT_SLOT_UART | INPUT_SLOT_GPIO])
+    uart = make_uart(rumble_frame(PICO_REPLY_MERGE, payload))
+    assert uart.wait_for_frame(PICO_REPLY_MERGE, timeout=0.0) == payload
+
+
+def test_merge_policy_values_match_firmware():
+    assert StickMergePolicy.PRIORITY == 0
+    assert StickMergePolicy.MAX_MAGNITUDE == 1
@@ -0,0 +1,57 @@
+"""Tests for the input recorder's run encoding and replies."""
+
+import struct
+
+import pytest
+from switch_pico_bridge.switch_pico_uart import (
+    PICO_FRAME_PAYLOAD_LENGTHS,
+    PICO_REPLY_RECORDER,
+    PICO_REPLY_RECORDER_RUNS,
+    RECORDED_RUN_LENGTH,
+    RecordedRun,
+    SwitchButton,
+    SwitchDpad,
+    decode_recorded_runs,
+    raw_dpad,
+)
+from tests.test_uart_protocol import make_uart, rumble_frame
+
+
+def test_run_layout_matches_firmware():
+    run = RecordedRun(0x01020304, 3, SwitchButton.A, SwitchDpad.LEFT, lx=0x123, ly=0x456, rx=0xFFF, ry=0)
+    data = run.to_bytes()
+    assert len(data) == RECORDED_RUN_LENGTH
+    assert data[:9] == struct.pack("<IHHB", 0x01020304, 3, 0x04, 0x06)
+    # Sticks are packed like the 0x30 report: 12-bit x, then 12-bit y.
+    assert data[9:12] == bytes([0x23, 0x61, 0x45])
+    assert data[12:15] == bytes([0xFF, 0x0F, 0x00])
+    assert RecordedRun.from_bytes(data) == run
+
+
+def test_run_keeps_opposing_raw_directions():
+    run = RecordedRun(5, 1, hat=raw_dpad(left=True, right=True))
+    data = run.to_bytes()
+    assert data[8] == 0x8C
+    assert RecordedRun.from_bytes(data).hat == 0x8C
+
+
+@pytest.mark.parametrize("kwargs", [{"repeat": 0}, {"lx": 4096}])
+def test_run_rejects_out_of_range_values(kwargs):
+    args = {"report": 0, "repeat": 1, **kwargs}
+    with pytest.raises(ValueError):
+        RecordedRun(**args).to_bytes()
+
+
+def test_runs_reply_ignores_unused_records():
+    runs = [RecordedRun(10, 2), RecordedRun(12, 1, SwitchButton.B)]
+    payload = struct.pack("<HB", 6, 2) + b"".join(r.to_bytes() for r in runs) + bytes(RECORDED_RUN_LENGTH)
+    assert len(payload) == PICO_FRAME_PAYLOAD_LENGTHS[PICO_REPLY_RECORDER_RUNS]
+    assert decode_recorded_runs(payload) == (6, runs)
+
+
+def test_recorder_status_is_parsed():
+    payload = struct.pack("<BBHHI", 0, 2, 40, 7, 123456)
+    uart = make_uart(rumble_frame(PICO_REPLY_RECORDER, payload))
+    status = uart.read_recorder_status(timeout=0.0)
+    assert status.ok and status.state == 2
+    assert (status.runs, status.position, status.report_count) == (40, 7, 123456)
@@ -0,0 +1,33 @@
+"""Tests for raw dpad encoding and the SOCD config frame."""
+
+from switch_pico_bridge.switch_pico_uart import (
+    PICO_REPLY_SOCD,
+    SocdMode,
+    SwitchControllerState,
+    SwitchDpad,
+    raw_dpad,
+)
+from tests.test_uart_protocol import make_uart, rumble_frame
+
+
+def test_raw_dpad_sets_flag_and_direction_bits():
+    assert raw_dpad() == 0x80
+    assert raw_dpad(up=True, down=True) == 0x83
+    assert raw_dpad(left=True, right=True) == 0x8C
+
+
+def test_raw_dpad_never_collides_with_hat_values():
+    hats = {int(h) for h in SwitchDpad}
+    assert all(raw_dpad(u, d, l, r) not in hats for u in (0, 1) for d in (0, 1) for l in (0, 1) for r in (0, 1))
+
+
+def test_state_serializes_raw_dpad_in_hat_byte():
+    state = SwitchControllerState()
+    state.set_raw_dpad(left=True, right=True)
+    frame = state.report.to_bytes()
+    assert frame[5] == 0x8C
+
+
+def test_socd_reply_frame_is_known():
+    uart = make_uart(rumble_frame(PICO_REPLY_SOCD, bytes([1, SocdMode.LAST_INPUT])))
+    assert uart.wait_for_frame(PICO_REPLY_SOCD, timeout=0.0) == bytes([1, 1])
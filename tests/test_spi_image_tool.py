@@ -0,0 +1,31 @@
+"""Tests for tools/spi_image_to_header.py."""
+
+import importlib.util
+from pathlib import Path
+
+import pytest
+
+_TOOL = Path(__file__).resolve().parent.parent / "tools" / "spi_image_to_header.py"
+_spec = importlib.util.spec_from_file_location("spi_image_to_header", _TOOL)
+spi_image_to_header = importlib.util.module_from_spec(_spec)
+_spec.loader.exec_module(spi_image_to_header)
+
+
+def test_split_pages_skips_erased_pages_and_trims_tail():
+    image = bytearray(b"\xff" * 0x9000)
+    image[0x6000:0x6003] = b"\x01\x02\x03"
+    image[0x8010:0x8012] = b"\xb2\xa1"
+    pages = spi_image_to_header.split_pages(bytes(image))
+    assert pages == [(0x6000, b"\x01\x02\x03"), (0x8000, b"\xff" * 0x10 + b"\xb2\xa1")]
+
+
+def test_split_pages_rejects_oversized_image():
+    with pytest.raises(ValueError):
+        spi_image_to_header.split_pages(b"\x00" * (spi_image_to_header.SPI_FLASH_SIZE + 1))
+
+
+def test_render_header_lists_every_page():
+    header = spi_image_to_header.render_header([(0x6000, b"\x01\x02")], "dump.bin")
+    assert "static const uint8_t spi_image_page_06000[2] = {" in header
+    assert "    0x01, 0x02," in header
+    assert "{0x06000, spi_image_page_06000, 2}," in header
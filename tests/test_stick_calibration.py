@@ -0,0 +1,33 @@
+"""Tests for the stick calibration learning reply."""
+
+import struct
+
+from switch_pico_bridge.switch_pico_uart import (
+    PICO_REPLY_STICK_CALIBRATION,
+    STICK_LEFT,
+    StickCalibrationStatus,
+)
+from tests.test_uart_protocol import make_uart, rumble_frame
+
+
+def calibration_payload(result=0, learning=1, saved=0, ranges=(0,) * 12):
+    return bytes([result, learning, saved]) + struct.pack("<12H", *ranges)
+
+
+def test_status_decodes_ranges_per_axis():
+    ranges = (0x200, 0x810, 0xE00, 0x100, 0x810, 0xF00, 0x15C, 0x800, 0xEA4, 0x15C, 0x800, 0xEA4)
+    status = StickCalibrationStatus.from_bytes(calibration_payload(saved=STICK_LEFT, ranges=ranges))
+    assert status.ok
+    assert status.learning
+    assert status.saved == STICK_LEFT
+    assert status.left_x == (0x200, 0x810, 0xE00)
+    assert status.left_y == (0x100, 0x810, 0xF00)
+    assert status.right_y == (0x15C, 0x800, 0xEA4)
+
+
+def test_status_reply_is_read_from_uart():
+    uart = make_uart(rumble_frame(PICO_REPLY_STICK_CALIBRATION, calibration_payload(result=2, learning=0)))
+    status = uart.read_stick_calibration_status(timeout=0.0)
+    assert status is not None
+    assert not status.ok
+    assert "range too small" in str(status)
@@ -0,0 +1,40 @@
+"""Tests for the firmware stick shaping config frame."""
+
+import pytest
+from switch_pico_bridge.switch_pico_uart import STICK_LEFT, STICK_RIGHT, StickShape, stick_shape_payload
+
+
+def test_stick_shape_payload_layout():
+    payload = stick_shape_payload(STICK_LEFT | STICK_RIGHT, StickShape(deadzone=8, anti_deadzone=15, saturation=95, expo=30))
+    assert payload == bytes([0x03, 8, 15, 95, 30, 0])
+
+
+def test_default_shape_is_raw_input():
+    assert stick_shape_payload(STICK_RIGHT, StickShape()) == bytes([0x02, 0, 0, 100, 0, 0])
+
+
+@pytest.mark.parametrize(
+    "shape",
+    [
+        StickShape(deadzone=50, saturation=50),
+        StickShape(saturation=101),
+        StickShape(anti_deadzone=100),
+        StickShape(expo=101),
+        StickShape(circle=True),
+    ],
+)
+def test_invalid_shapes_are_rejected(shape):
+    with pytest.raises(ValueError):
+        stick_shape_payload(STICK_LEFT, shape)
+
+
+def test_radial_flags():
+    assert stick_shape_payload(STICK_LEFT, StickShape(deadzone=10, radial=True, circle=True))[-1] == 0x03
+    assert stick_shape_payload(STICK_LEFT, StickShape(radial=True))[-1] == 0x01
+
+
+def test_sticks_mask_is_checked():
+    with pytest.raises(ValueError):
+        stick_shape_payload(0, StickShape())
+    with pytest.raises(ValueError):
+        stick_shape_payload(0x04, StickShape())
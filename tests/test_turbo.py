@@ -0,0 +1,18 @@
+"""Tests for the firmware turbo config frame."""
+
+import pytest
+from switch_pico_bridge.switch_pico_uart import SwitchButton, turbo_payload
+
+
+def test_turbo_payload_layout():
+    assert turbo_payload(SwitchButton.A | SwitchButton.ZR, 2, 1) == bytes([0x84, 0x00, 2, 1])
+
+
+def test_turbo_can_be_disabled():
+    assert turbo_payload(0xFFFF, 0, 0) == bytes([0xFF, 0xFF, 0, 0])
+
+
+@pytest.mark.parametrize("on,off", [(1, 0), (256, 1), (1, -1)])
+def test_turbo_payload_rejects_bad_rates(on, off):
+    with pytest.raises(ValueError):
+        turbo_payload(SwitchButton.A, on, off)
@@ -6,15 +6,52 @@ from switch_pico_bridge.switch_pico_uart import (
     SwitchReport,
     IMUSample,
     SwitchDpad,
+    PicoUART,
     UART_HEADER,
     UART_PROTOCOL_VERSION,
+    RUMBLE_HEADER,
+    RUMBLE_TYPE_RUMBLE,
+    RUMBLE_TYPE_COMPACT,
+    RUMBLE_TYPE_TIMED,
     ACCEL_LSB_PER_G,
     GYRO_LSB_PER_RAD_S,
     MS2_PER_G,
     compute_checksum,
+    decode_rumble,
+    decode_rumble_frequencies,
+    decode_rumble_timestamp,
+    RumbleLatencyTracker,
 )
 
 
+class FakeSerial:
+    """Minimal stand-in for serial.Serial that serves queued bytes."""
+
+    def __init__(self, data: bytes = b"") -> None:
+        self.data = bytearray(data)
+
+    @property
+    def in_waiting(self) -> int:
+        return len(self.data)
+
+    def read(self, size: int) -> bytes:
+        chunk = bytes(self.data[:size])
+        del self.data[:size]
+        return chunk
+
+
+def make_uart(data: bytes) -> PicoUART:
+    uart = PicoUART.__new__(PicoUART)
+    uart.serial = FakeSerial(data)
+    uart._buffer = bytearray()
+    return uart
+
+
+def rumble_frame(frame_type: int, payload: bytes) -> bytes:
+    frame = bytes([RUMBLE_HEADER, frame_type]) + payload
+    return frame + bytes([compute_checksum(frame)])
+
+
 def test_v2_frame_with_imu_samples():
     """V2 frame with 3 IMU samples should be 48 bytes with correct layout."""
     r = SwitchReport(
@@ -118,3 +155,76 @@ def test_max_imu_samples_capped():
     assert len(data) == 48  # 3 samples, not 5
     assert data[10] == 3
     assert data[2] == 44  # payload_len for 3 samples
+
+
+def test_rumble_parser_handles_compact_and_raw_frames():
+    """Compact (4-byte) and legacy raw (8-byte) rumble frames parse from one stream."""
+    compact = bytes([0xFF, 32, 0x80, 64])
+    raw = bytes([0x00, 0x01, 0x40, 0x40, 0x00, 0x01, 0x40, 0x40])
+    stream = b"\x00" + rumble_frame(RUMBLE_TYPE_COMPACT, compact) + rumble_frame(RUMBLE_TYPE_RUMBLE, raw)
+    uart = make_uart(stream)
+    assert uart.read_rumble_payload() == compact
+    assert uart.read_rumble_payload() == raw
+    assert uart.read_rumble_payload() is None
+
+
+def test_rumble_parser_waits_for_partial_frame_and_skips_bad_checksum():
+    """A truncated frame is kept for later; a corrupted one is discarded."""
+    good = rumble_frame(RUMBLE_TYPE_COMPACT, bytes([10, 32, 20, 64]))
+    bad = bytearray(good)
+    bad[-1] ^= 0xFF
+    uart = make_uart(bytes(bad) + good[:4])
+    assert uart.read_rumble_payload() is None
+    uart.serial.data.extend(good[4:])
+    assert uart.read_rumble_payload() == bytes([10, 32, 20, 64])
+
+
+def test_decode_compact_rumble():
+    """Compact payloads decode to low/high band amplitudes and 5 Hz-unit frequencies."""
+    low, high = decode_rumble(bytes([255, 32, 0, 64]))
+    assert low == 1.0
+    assert high == 0.0
+    assert decode_rumble_frequencies(bytes([255, 32, 0, 64])) == (160, 320)
+    assert decode_rumble_frequencies(bytes(8)) is None
+
+
+def timed_payload(arrival_us: int, dwell_us: int, bands: bytes = bytes([128, 32, 64, 64])) -> bytes:
+    return bands + struct.pack("<IH", arrival_us & 0xFFFFFFFF, dwell_us)
+
+
+def test_timed_rumble_frame_decodes_bands_and_timestamp():
+    """Timed frames parse like compact ones and expose arrival/dwell."""
+    payload = timed_payload(123456, 250)
+    uart = make_uart(rumble_frame(RUMBLE_TYPE_TIMED, payload))
+    assert uart.read_rumble_payload() == payload
+    assert decode_rumble(payload) == (128 / 255.0, 64 / 255.0)
+    assert decode_rumble_timestamp(payload) == (123456, 250)
+    assert decode_rumble_timestamp(bytes(4)) is None
+
+
+def test_rumble_latency_tracker_aligns_clocks_and_skips_refreshes():
+    """Latency is measured against the fastest delivery; refreshes are ignored."""
+    tracker = RumbleLatencyTracker()
+    # Pico clock runs 100 s behind the host; best-case transport is 1 ms.
+    arrival = tracker.observe_frame(timed_payload(1_000_000, 500), 101.0015)
+    assert arrival is not None
+    tracker.record_applied(arrival, arrival + 0.003)
+    # A slower delivery of a new report is measured against the earlier minimum.
+    arrival = tracker.observe_frame(timed_payload(2_000_000, 500), 102.0065)
+    assert abs((102.0065 - arrival) - 0.0055) < 1e-6  # 0.5 ms dwell + 5 ms slower UART
+    tracker.record_applied(arrival, 102.0065)
+    # Same arrival time again is a periodic refresh.
+    assert tracker.observe_frame(timed_payload(2_000_000, 60_000), 102.0615) is None
+    assert tracker.samples == 2
+    assert tracker.counts[2] == 1  # 2-4 ms
+    assert tracker.counts[3] == 1  # 4-8 ms
+    assert tracker.format_histogram()[0].startswith("rumble latency: n=2")
+
+
+def test_rumble_latency_tracker_unwraps_pico_clock():
+    """The 32-bit microsecond counter wrapping does not break clock alignment."""
+    tracker = RumbleLatencyTracker()
+    tracker.observe_frame(timed_payload(0xFFFFF000, 0), 10.0)
+    arrival = tracker.observe_frame(timed_payload(0x00001000, 0), 10.008192)
+    assert arrival is not None
+    assert abs(arrival - 10.008192) < 1e-6
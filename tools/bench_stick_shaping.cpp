@@ -0,0 +1,139 @@
+/*
+ * Host benchmark for stick_shaping.cpp: checks the fixed-point axial and
+ * radial paths against a double-precision reference over a grid of stick positions and
+ * times both. Host timings only rank the two; the firmware's
+ * SWITCH_PICO_BENCH build prints M0+ cycle counts for the fixed-point path.
+ *
+ *   g++ -O2 -I. tools/bench_stick_shaping.cpp stick_shaping.cpp -o bench_stick_shaping
+ *   ./bench_stick_shaping
+ */
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include "stick_shaping.h"
+
+static double shape_reference(const StickShapeConfig& config, double magnitude) {
+    double deadzone = config.deadzone / 100.0;
+    double saturation = config.saturation / 100.0;
+    if (magnitude <= deadzone) {
+        return 0.0;
+    }
+    double t = magnitude >= saturation ? 1.0 : (magnitude - deadzone) / (saturation - deadzone);
+    double expo = config.expo / 100.0;
+    double curved = t * (1.0 - expo) + t * t * t * expo;
+    double anti = config.anti_deadzone / 100.0;
+    return anti + (1.0 - anti) * curved;
+}
+
+static uint16_t to_axis_reference(double v) {
+    double value = std::lround(32768.0 + v * 32768.0);
+    return static_cast<uint16_t>(value < 0 ? 0 : value > 65535 ? 65535 : value);
+}
+
+// Per axis; the positive side reaches full deflection at 0xFFFF.
+static uint16_t axis_reference(const StickShapeConfig& config, uint16_t value) {
+    if (value < 32768) {
+        return to_axis_reference(-shape_reference(config, (32768.0 - value) / 32768.0));
+    }
+    return to_axis_reference(shape_reference(config, (value - 32768.0) / 32767.0) * 32767.0 / 32768.0);
+}
+
+static void apply_reference(const StickShapeConfig& config, uint16_t* x, uint16_t* y) {
+    if (!(config.flags & STICK_SHAPE_RADIAL)) {
+        *x = axis_reference(config, *x);
+        *y = axis_reference(config, *y);
+        return;
+    }
+    double dx = (*x - 32768.0) / 32768.0;
+    double dy = (*y - 32768.0) / 32768.0;
+    double length = std::hypot(dx, dy);
+    if (length == 0.0) {
+        *x = *y = 32768;
+        return;
+    }
+    double deflection = (config.flags & STICK_SHAPE_CIRCLE) ? std::fmax(std::fabs(dx), std::fabs(dy)) : length;
+    double scale = shape_reference(config, std::fmin(deflection, 1.0)) / length;
+    *x = to_axis_reference(dx * scale);
+    *y = to_axis_reference(dy * scale);
+}
+
+static bool check_isqrt() {
+    for (uint64_t v = 0; v <= 0xFFFFFFFFull; v += (v < 1u << 20) ? 1 : 9973) {
+        uint32_t root = stick_isqrt32(static_cast<uint32_t>(v));
+        if (static_cast<uint64_t>(root) * root > v || static_cast<uint64_t>(root + 1) * (root + 1) <= v) {
+            std::printf("isqrt(%llu) = %u is wrong\n", static_cast<unsigned long long>(v), root);
+            return false;
+        }
+    }
+    return true;
+}
+
+// Error in the 12-bit units the console receives.
+static void compare(const char* name, const StickShapeConfig& config) {
+    StickShaper shaper;
+    stick_shaper_build(&shaper, config);
+    int worst = 0;
+    double total = 0.0;
+    uint32_t samples = 0;
+    for (uint32_t gx = 0; gx <= 0xFFFF; gx += 97) {
+        for (uint32_t gy = 0; gy <= 0xFFFF; gy += 97) {
+            uint16_t fx = static_cast<uint16_t>(gx), fy = static_cast<uint16_t>(gy);
+            uint16_t rx = fx, ry = fy;
+            stick_shaper_apply(shaper, &fx, &fy);
+            apply_reference(config, &rx, &ry);
+            int error = std::max(std::abs((fx >> 4) - (rx >> 4)), std::abs((fy >> 4) - (ry >> 4)));
+            worst = std::max(worst, error);
+            total += error;
+            samples++;
+        }
+    }
+    std::printf("%-26s max error %d, mean %.3f (12-bit units, %u positions)\n", name, worst, total / samples, samples);
+}
+
+template <typename Fn>
+static double time_ns_per_stick(Fn&& fn) {
+    const uint32_t rounds = 4;
+    uint32_t sink = 0;
+    uint32_t calls = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (uint32_t round = 0; round < rounds; ++round) {
+        for (uint32_t gx = 0; gx <= 0xFFFF; gx += 61) {
+            for (uint32_t gy = 0; gy <= 0xFFFF; gy += 61) {
+                uint16_t x = static_cast<uint16_t>(gx), y = static_cast<uint16_t>(gy);
+                fn(&x, &y);
+                sink += x ^ y;
+                calls++;
+            }
+        }
+    }
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    if (sink == 0xFFFFFFFFu) {
+        std::puts("");  // keep the results live
+    }
+    return std::chrono::duration<double, std::nano>(elapsed).count() / calls;
+}
+
+int main() {
+    if (!check_isqrt()) {
+        return 1;
+    }
+    std::puts("isqrt matches floor(sqrt) on all sampled inputs");
+
+    const StickShapeConfig axial = {8, 15, 92, 60, 0};
+    const StickShapeConfig radial = {10, 0, 100, 0, STICK_SHAPE_RADIAL};
+    const StickShapeConfig circle = {10, 0, 100, 0, STICK_SHAPE_RADIAL | STICK_SHAPE_CIRCLE};
+    const StickShapeConfig curved = {8, 15, 92, 60, STICK_SHAPE_RADIAL | STICK_SHAPE_CIRCLE};
+    compare("axial anti-dz + expo", axial);
+    compare("radial deadzone", radial);
+    compare("square to circle", circle);
+    compare("circle + anti-dz + expo", curved);
+
+    StickShaper shaper;
+    stick_shaper_build(&shaper, curved);
+    double fixed = time_ns_per_stick([&](uint16_t* x, uint16_t* y) { stick_shaper_apply(shaper, x, y); });
+    double reference = time_ns_per_stick([&](uint16_t* x, uint16_t* y) { apply_reference(curved, x, y); });
+    std::printf("fixed point %.1f ns/stick, double reference %.1f ns/stick (host)\n", fixed, reference);
+    return 0;
+}
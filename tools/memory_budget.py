@@ -0,0 +1,201 @@
+#!/usr/bin/env python3
+"""
+Report the firmware's static memory footprint and enforce its budgets.
+
+Reads symbol sizes from `nm` and per-function stack frames from the `.su`
+files written by `-fstack-usage`. Run by CMake after every link of the
+switch-pico targets; it can also be run by hand on any built ELF.
+"""
+
+import argparse
+import subprocess
+import sys
+from dataclasses import dataclass
+from pathlib import Path
+from typing import Dict, Iterable, List, Optional
+
+# RP2040 address map: XIP flash and striped SRAM (including the scratch banks).
+FLASH_BASE, FLASH_END = 0x10000000, 0x11000000
+RAM_BASE, RAM_END = 0x20000000, 0x20042000
+
+# Any of these in the image means something reached for the heap.
+HEAP_SYMBOLS = {
+    "malloc",
+    "free",
+    "calloc",
+    "realloc",
+    "_malloc_r",
+    "_free_r",
+    "_calloc_r",
+    "_realloc_r",
+    "_sbrk",
+    "_sbrk_r",
+    "__wrap_malloc",
+    "__wrap_calloc",
+    "__wrap_realloc",
+    "__wrap_free",
+}
+HEAP_SYMBOL_PREFIXES = ("operator new", "operator delete")
+
+
+@dataclass
+class Symbol:
+    address: int
+    size: int
+    kind: str  # nm type letter
+    name: str
+
+    @property
+    def section(self) -> str:
+        kind = self.kind.lower()
+        if kind in ("t", "w"):
+            return ".text"
+        if kind == "r":
+            return ".rodata"
+        if kind in ("d", "g"):
+            return ".data"
+        if kind in ("b", "s"):
+            return ".bss"
+        return "other"
+
+    @property
+    def in_ram(self) -> bool:
+        return RAM_BASE <= self.address < RAM_END
+
+    @property
+    def in_flash(self) -> bool:
+        return FLASH_BASE <= self.address < FLASH_END
+
+
+@dataclass
+class StackFrame:
+    function: str
+    size: int
+    qualifier: str  # static, dynamic, or "dynamic,bounded"
+
+
+def parse_nm(text: str) -> List[Symbol]:
+    """Parse `nm --print-size --radix=d -C` output; symbols without a size are skipped."""
+    symbols = []
+    for line in text.splitlines():
+        parts = line.split(maxsplit=3)
+        if len(parts) < 4 or not parts[0].isdigit() or not parts[1].isdigit():
+            continue
+        symbols.append(Symbol(int(parts[0]), int(parts[1]), parts[2], parts[3]))
+    return symbols
+
+
+def parse_stack_usage(text: str) -> List[StackFrame]:
+    """Parse the `file:line:col:function<TAB>bytes<TAB>qualifier` lines of a .su file."""
+    frames = []
+    for line in text.splitlines():
+        fields = line.split("\t")
+        if len(fields) != 3 or not fields[1].isdigit():
+            continue
+        location = fields[0]
+        function = location.split(":", 3)[-1] if location.count(":") >= 3 else location
+        frames.append(StackFrame(function, int(fields[1]), fields[2]))
+    return frames
+
+
+def heap_symbols(symbols: Iterable[Symbol]) -> List[str]:
+    found = set()
+    for sym in symbols:
+        if sym.name in HEAP_SYMBOLS or sym.name.startswith(HEAP_SYMBOL_PREFIXES):
+            found.add(sym.name)
+    return sorted(found)
+
+
+def summarize(symbols: Iterable[Symbol]) -> Dict[str, int]:
+    """Totals per region. .data costs both RAM and flash (its initial values live in flash)."""
+    totals = {"ram": 0, "flash": 0, ".text": 0, ".rodata": 0, ".data": 0, ".bss": 0}
+    for sym in symbols:
+        if sym.section in totals:
+            totals[sym.section] += sym.size
+        if sym.in_ram:
+            totals["ram"] += sym.size
+            if sym.section == ".data" or sym.section == ".text":
+                totals["flash"] += sym.size  # copied out of flash at boot
+        elif sym.in_flash:
+            totals["flash"] += sym.size
+    return totals
+
+
+def render_report(symbols: List[Symbol], frames: List[StackFrame], top: int) -> str:
+    totals = summarize(symbols)
+    lines = [
+        f"RAM   {totals['ram']:>8} bytes   flash {totals['flash']:>8} bytes",
+        f".text {totals['.text']:>8}   .rodata {totals['.rodata']:>8}   "
+        f".data {totals['.data']:>8}   .bss {totals['.bss']:>8}",
+    ]
+    for title, selected in (
+        ("RAM", [s for s in symbols if s.in_ram]),
+        ("flash", [s for s in symbols if s.in_flash]),
+    ):
+        lines.append(f"Largest {title} symbols:")
+        for sym in sorted(selected, key=lambda s: s.size, reverse=True)[:top]:
+            lines.append(f"  {sym.size:>7}  {sym.section:<8} {sym.name}")
+    if frames:
+        deepest = sorted(frames, key=lambda f: f.size, reverse=True)
+        lines.append(f"Largest stack frames (-fstack-usage, {len(frames)} functions):")
+        for frame in deepest[:top]:
+            lines.append(f"  {frame.size:>7}  {frame.qualifier:<16} {frame.function}")
+        dynamic = [f.function for f in frames if f.qualifier.startswith("dynamic") and "bounded" not in f.qualifier]
+        if dynamic:
+            lines.append("Unbounded dynamic stack use: " + ", ".join(sorted(dynamic)))
+    return "\n".join(lines)
+
+
+def load_frames(su_dir: Optional[Path]) -> List[StackFrame]:
+    if not su_dir or not su_dir.is_dir():
+        return []
+    frames = []
+    for su_file in sorted(su_dir.rglob("*.su")):
+        frames.extend(parse_stack_usage(su_file.read_text(errors="replace")))
+    return frames
+
+
+def main(argv=None) -> int:
+    parser = argparse.ArgumentParser(description=__doc__.strip().splitlines()[0])
+    parser.add_argument("elf", type=Path)
+    parser.add_argument("--nm", default="arm-none-eabi-nm", help="nm binary for the target toolchain")
+    parser.add_argument("--su-dir", type=Path, help="Directory searched for .su files")
+    parser.add_argument("--ram-budget", type=int, default=0, help="Fail above this many bytes of static RAM (0 = off)")
+    parser.add_argument("--flash-budget", type=int, default=0, help="Fail above this many bytes of flash (0 = off)")
+    parser.add_argument("--no-heap", action="store_true", help="Fail if any allocator symbol is linked in")
+    parser.add_argument("--top", type=int, default=10, help="Symbols/frames listed per table")
+    args = parser.parse_args(argv)
+
+    try:
+        nm_output = subprocess.run(
+            [args.nm, "--print-size", "--size-sort", "--radix=d", "-C", str(args.elf)],
+            check=True,
+            capture_output=True,
+            text=True,
+        ).stdout
+    except (OSError, subprocess.CalledProcessError) as exc:
+        print(f"error: running {args.nm} failed: {exc}", file=sys.stderr)
+        return 1
+
+    symbols = parse_nm(nm_output)
+    print(f"Memory budget for {args.elf.name}")
+    print(render_report(symbols, load_frames(args.su_dir), args.top))
+
+    failed = False
+    if args.no_heap:
+        found = heap_symbols(symbols)
+        if found:
+            print("error: heap-free build links allocator symbols: " + ", ".join(found), file=sys.stderr)
+            failed = True
+    totals = summarize(symbols)
+    if args.ram_budget and totals["ram"] > args.ram_budget:
+        print(f"error: static RAM {totals['ram']} exceeds budget {args.ram_budget}", file=sys.stderr)
+        failed = True
+    if args.flash_budget and totals["flash"] > args.flash_budget:
+        print(f"error: flash {totals['flash']} exceeds budget {args.flash_budget}", file=sys.stderr)
+        failed = True
+    return 1 if failed else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,75 @@
+#!/usr/bin/env python3
+"""
+Convert a dumped Pro Controller SPI flash image into a C header for the firmware.
+
+The image is split into 4 KB pages. Pages that are entirely erased (0xFF) are
+skipped and trailing 0xFF bytes are trimmed, so only real data ends up in the
+Pico's flash. The result is consumed by spi_flash_image.cpp when the firmware
+is configured with -DSWITCH_PICO_SPI_IMAGE=/path/to/dump.bin.
+"""
+
+import argparse
+import sys
+from pathlib import Path
+from typing import List, Tuple
+
+SPI_FLASH_SIZE = 0x80000
+SPI_FLASH_PAGE_SIZE = 0x1000
+
+
+def split_pages(image: bytes) -> List[Tuple[int, bytes]]:
+    """Return (address, data) for every page holding non-erased bytes, trailing 0xFF trimmed."""
+    if len(image) > SPI_FLASH_SIZE:
+        raise ValueError(f"SPI image is {len(image)} bytes; expected at most {SPI_FLASH_SIZE}")
+    pages = []
+    for address in range(0, len(image), SPI_FLASH_PAGE_SIZE):
+        data = image[address : address + SPI_FLASH_PAGE_SIZE].rstrip(b"\xff")
+        if data:
+            pages.append((address, data))
+    return pages
+
+
+def render_header(pages: List[Tuple[int, bytes]], source_name: str) -> str:
+    lines = [
+        f"// Generated by tools/spi_image_to_header.py from {source_name}. Do not edit.",
+        "#pragma once",
+        "",
+        '#include "spi_flash_image.h"',
+        "",
+    ]
+    for address, data in pages:
+        lines.append(f"static const uint8_t spi_image_page_{address:05x}[{len(data)}] = {{")
+        for row in range(0, len(data), 16):
+            chunk = data[row : row + 16]
+            lines.append("    " + ", ".join(f"0x{b:02X}" for b in chunk) + ",")
+        lines.append("};")
+        lines.append("")
+    lines.append("static const SpiFlashConstPage spi_image_pages[] = {")
+    for address, data in pages:
+        lines.append(f"    {{0x{address:05X}, spi_image_page_{address:05x}, {len(data)}}},")
+    if not pages:
+        # Keep the array non-empty so the range-for in spi_flash_image_init() compiles.
+        lines.append("    {0, nullptr, 0},")
+    lines.append("};")
+    lines.append("")
+    return "\n".join(lines)
+
+
+def main(argv=None) -> int:
+    parser = argparse.ArgumentParser(description=__doc__.strip().splitlines()[0])
+    parser.add_argument("image", type=Path, help="Raw SPI dump (up to 512 KB)")
+    parser.add_argument("output", type=Path, help="Header to write")
+    args = parser.parse_args(argv)
+
+    try:
+        pages = split_pages(args.image.read_bytes())
+    except (OSError, ValueError) as exc:
+        print(f"error: {exc}", file=sys.stderr)
+        return 1
+    args.output.write_text(render_header(pages, args.image.name))
+    print(f"Wrote {len(pages)} page(s) to {args.output}")
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,68 @@
+#include "turbo.h"
+
+#include "pico/platform.h"
+
+#define TURBO_BUTTON_COUNT 16
+
+static uint8_t g_on_reports[TURBO_BUTTON_COUNT];
+static uint8_t g_off_reports[TURBO_BUTTON_COUNT];
+static uint8_t g_remaining[TURBO_BUTTON_COUNT];  // reports left in the current phase
+static uint16_t g_enabled = 0;
+static uint16_t g_held = 0;      // turbo buttons held by the host at the last report
+static uint16_t g_phase_on = 0;  // turbo buttons currently in their "on" phase
+
+bool turbo_configure(uint16_t mask, uint8_t on_reports, uint8_t off_reports) {
+    if (on_reports != 0 && off_reports == 0) {
+        return false;
+    }
+    for (uint8_t bit = 0; bit < TURBO_BUTTON_COUNT; ++bit) {
+        if (mask & (1u << bit)) {
+            g_on_reports[bit] = on_reports;
+            g_off_reports[bit] = off_reports;
+        }
+    }
+    if (on_reports) {
+        g_enabled |= mask;
+    } else {
+        g_enabled &= static_cast<uint16_t>(~mask);
+    }
+    g_held &= static_cast<uint16_t>(~mask);  // reconfigured buttons restart their pattern
+    return true;
+}
+
+uint16_t turbo_enabled_mask() {
+    return g_enabled;
+}
+
+static void __not_in_flash_func(advance)(uint16_t held) {
+    for (uint8_t bit = 0; bit < TURBO_BUTTON_COUNT; ++bit) {
+        uint16_t flag = static_cast<uint16_t>(1u << bit);
+        if (!(held & flag)) {
+            continue;
+        }
+        if (!(g_held & flag)) {
+            g_phase_on |= flag;  // fresh press: start with "on"
+            g_remaining[bit] = g_on_reports[bit];
+        } else if (--g_remaining[bit] == 0) {
+            g_phase_on ^= flag;
+            g_remaining[bit] = (g_phase_on & flag) ? g_on_reports[bit] : g_off_reports[bit];
+        }
+    }
+    g_held = held;
+}
+
+void __not_in_flash_func(turbo_apply)(SwitchInputState* state, bool new_report) {
+    if (!g_enabled) {
+        return;
+    }
+    uint16_t buttons = switch_input_buttons(*state);
+    uint16_t held = buttons & g_enabled;
+    if (new_report) {
+        advance(held);
+    }
+    // Between reports only a release can change the output.
+    uint16_t suppressed = held & g_held & static_cast<uint16_t>(~g_phase_on);
+    if (suppressed) {
+        switch_input_set_buttons(state, static_cast<uint16_t>(buttons & ~suppressed));
+    }
+}
@@ -0,0 +1,24 @@
+/*
+ * Rapid fire for buttons the host holds down, counted in 0x30 reports: a
+ * turbo button alternates between on for N reports and off for M reports,
+ * so every press and release lands on its own report however fast the host
+ * sends input. The pattern restarts (with "on") each time the button is
+ * pressed, so a short tap always registers.
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "switch_pro_driver.h"
+
+// Set the rate for every button in mask (SWITCH_PRO_MASK_*). on_reports of
+// 0 turns turbo off for those buttons; off_reports is then ignored. Returns
+// false for a zero off_reports with turbo on.
+bool turbo_configure(uint16_t mask, uint8_t on_reports, uint8_t off_reports);
+
+// Buttons with turbo enabled.
+uint16_t turbo_enabled_mask();
+
+// Report filter stage; runs on the host's input, ahead of macros.
+void turbo_apply(SwitchInputState* state, bool new_report);
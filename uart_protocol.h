@@ -0,0 +1,77 @@
+/*
+ * Frame constants for the UART1 link to the host PC. Every frame is
+ *
+ *   header, type, [length,] payload..., checksum (sum of all preceding bytes)
+ *
+ * Host -> Pico frames start with 0xAA and always carry a length byte. Pico ->
+ * host frames start with 0xBB; their payload length is implied by the type.
+ * Keep in sync with src/switch_pico_bridge/switch_pico_uart.py.
+ */
+
+#pragma once
+
+// Host -> Pico
+#define UART_FRAME_HEADER 0xAA
+#define UART_FRAME_INPUT 0x02         // controller state (historically the "v2" marker)
+#define UART_FRAME_IDENTITY_SET 0x10  // DeviceIdentity record to store
+#define UART_FRAME_IDENTITY_GET 0x11  // empty; answered with UART_REPLY_IDENTITY
+#define UART_FRAME_MACRO_UPLOAD 0x20   // offset (LE16) + bytecode for the RAM macro slot
+#define UART_FRAME_MACRO_CONTROL 0x21  // command byte + arguments, see below
+#define UART_FRAME_RECORDER 0x30       // command byte + arguments, see below
+#define UART_FRAME_TURBO 0x40          // buttons (LE16), on reports, off reports; on = 0 disables
+#define UART_FRAME_STICK_SHAPE 0x41    // sticks (bit 0 left, bit 1 right) + StickShapeConfig
+#define UART_FRAME_SOCD 0x42           // SocdMode
+#define UART_FRAME_MERGE 0x43          // MergeStickPolicy
+#define UART_FRAME_STICK_CALIBRATION 0x44  // command byte, see below
+#define UART_FRAME_MAX_LENGTH 64      // whole frame, header to checksum
+
+// Pico -> host
+#define UART_RUMBLE_HEADER 0xBB
+#define UART_RUMBLE_RUMBLE_TYPE 0x01  // raw 8-byte HD rumble payload (legacy)
+#define UART_RUMBLE_COMPACT_TYPE 0x02 // decoded low/high band amplitude + frequency
+#define UART_RUMBLE_TIMED_TYPE 0x03   // compact bands + USB arrival time + dwell (us)
+#define UART_REPLY_IDENTITY 0x10      // status byte + DeviceIdentity record
+#define UART_REPLY_MACRO 0x20         // result, state, pc (LE16), library slot playing (0xFF = none)
+#define UART_REPLY_MACRO_SLOT 0x21    // slot, length (LE16), chord (LE16), name[16]
+#define UART_REPLY_RECORDER 0x30      // result, state, runs (LE16), replay position (LE16), report count (LE32)
+#define UART_REPLY_RECORDER_RUNS 0x31 // index (LE16), count, RECORDER_RUNS_PER_FRAME RecordedRuns (unused zeroed)
+#define UART_REPLY_TURBO 0x40         // accepted (1/0), turbo-enabled buttons (LE16)
+#define UART_REPLY_STICK_SHAPE 0x41   // accepted (1/0)
+#define UART_REPLY_SOCD 0x42          // accepted (1/0), current SocdMode
+#define UART_REPLY_MERGE 0x43         // accepted (1/0), current MergeStickPolicy, active input slots (bit per InputSlot)
+#define UART_REPLY_STICK_CALIBRATION 0x44  // result, learning (1/0), sticks saved (bit 0 left, bit 1 right),
+                                           // then per stick x min, centre, max, y min, centre, max (LE16 each)
+
+// Input frame hat byte: with bit 7 set, the low four bits are raw dpad
+// directions instead of a SWITCH_PRO_HAT_* value, so opposing directions can
+// be held together (resolved by the SOCD stage).
+#define UART_HAT_RAW 0x80
+#define UART_HAT_RAW_UP 0x01
+#define UART_HAT_RAW_DOWN 0x02
+#define UART_HAT_RAW_LEFT 0x04
+#define UART_HAT_RAW_RIGHT 0x08
+
+// UART_FRAME_MACRO_CONTROL commands
+#define MACRO_CONTROL_STOP 0x00
+#define MACRO_CONTROL_RUN 0x01     // length (LE16) of the uploaded program
+#define MACRO_CONTROL_STATUS 0x02
+#define MACRO_CONTROL_PLAY_SLOT 0x03    // slot
+#define MACRO_CONTROL_SAVE_SLOT 0x04    // slot, length (LE16), chord (LE16), name (0-16 bytes)
+#define MACRO_CONTROL_DELETE_SLOT 0x05  // slot
+#define MACRO_CONTROL_LIST 0x06         // one UART_REPLY_MACRO_SLOT per slot, then the status reply
+
+// UART_FRAME_RECORDER commands; each is answered with UART_REPLY_RECORDER
+#define RECORDER_CONTROL_STOP 0x00
+#define RECORDER_CONTROL_RECORD 0x01
+#define RECORDER_CONTROL_REPLAY 0x02
+#define RECORDER_CONTROL_STATUS 0x03
+#define RECORDER_CONTROL_READ 0x04   // index (LE16); answered with UART_REPLY_RECORDER_RUNS only
+#define RECORDER_CONTROL_WRITE 0x05  // index (LE16) + up to RECORDER_RUNS_PER_FRAME RecordedRuns
+#define RECORDER_RUNS_PER_FRAME 3
+
+// UART_FRAME_STICK_CALIBRATION commands; each is answered with UART_REPLY_STICK_CALIBRATION
+#define STICK_CALIBRATION_CONTROL_STOP 0x00
+#define STICK_CALIBRATION_CONTROL_LEARN 0x01
+#define STICK_CALIBRATION_CONTROL_SAVE 0x02   // store the learned ranges as the user calibration
+#define STICK_CALIBRATION_CONTROL_CLEAR 0x03  // back to the factory calibration
+#define STICK_CALIBRATION_CONTROL_STATUS 0x04